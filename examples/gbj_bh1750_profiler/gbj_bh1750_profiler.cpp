@@ -0,0 +1,164 @@
+/*
+  NAME:
+  Cost profile of BH1750 sensor configurations using gbjBH1750 library.
+
+  DESCRIPTION:
+  The sketch sweeps all measurement modes and the measurement time register
+  range and prints a table of costs of a measurement for each configuration
+  in CSV format for choosing the cheapest configuration for a deployment.
+  - Latency is measured end-to-end by the function micros() as average and
+    maximum of several measurements.
+  - Bus occupancy is calculated from transactions of a measurement, i.e.,
+    the measurement instruction in one time modes and the reading of the data
+    register, in bytes including address bytes and in microseconds for
+    100 kHz and 400 kHz bus clock including start and stop conditions.
+  - Energy of the sensor per measurement is estimated in nanojoules from the
+    typical supply current in active state at 3 V and the active time, i.e.,
+    the typical conversion time in one time modes and the whole sampling
+    period in continuous modes. Current in power down state is negligible.
+  - On the host with build flag GBJ_BH1750_TRANSPORT_SIM the sketch runs
+    on the simulator in virtual time, with GBJ_BH1750_TRANSPORT_LINUX on a
+    real sensor at /dev/i2c-1. Both host builds have the function main().
+  - Connect sensor's pins to microcontroller's I2C bus or I2C default pins
+    as described in README.md for used platform accordingly.
+  - Leave ADDR pin floating or connected to GND in order to use default address.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+*/
+#include "gbj_bh1750.h"
+#if defined(GBJ_BH1750_TRANSPORT_SIM) || defined(GBJ_BH1750_TRANSPORT_LINUX)
+  #include <stdio.h>
+#endif
+
+#define PROFILE_SAMPLES 3 // Measurements per configuration
+#define PROFILE_MTREG_MIN 31 // Minimal value of measurement time register
+#define PROFILE_MTREG_TYP 69 // Typical value of measurement time register
+#define PROFILE_MTREG_MAX 254 // Maximal value of measurement time register
+#define PROFILE_MTREG_STEP 32 // Step of measurement time register sweep
+#define PROFILE_CURRENT 120 // Typical supply current in active state in uA
+#define PROFILE_VOLTAGE 3000 // Supply voltage in mV
+#define PROFILE_BITS_BYTE 9 // Bits per byte including acknowledge
+#define PROFILE_BITS_FRAME 2 // Bits of start and stop conditions
+
+gbj_bh1750 sensor = gbj_bh1750();
+// gbj_bh1750 sensor = gbj_bh1750(sensor.CLOCK_100KHZ, D2, D1);
+// gbj_bh1750 sensor = gbj_bh1750(sensor.CLOCK_400KHZ);
+
+const gbj_bh1750::Modes modes[] = {
+  gbj_bh1750::MODE_CONTINUOUS_HIGH, gbj_bh1750::MODE_CONTINUOUS_HIGH2,
+  gbj_bh1750::MODE_CONTINUOUS_LOW,  gbj_bh1750::MODE_ONETIME_HIGH,
+  gbj_bh1750::MODE_ONETIME_HIGH2,   gbj_bh1750::MODE_ONETIME_LOW,
+};
+
+void output(const char *line)
+{
+#if defined(GBJ_BH1750_TRANSPORT_SIM) || defined(GBJ_BH1750_TRANSPORT_LINUX)
+  puts(line);
+#else
+  Serial.println(line);
+#endif
+}
+
+// Bus time in microseconds of transactions with bytes including address ones
+unsigned long busTime(uint8_t transactions, uint8_t bytes, uint32_t clock)
+{
+  uint32_t bits =
+    bytes * PROFILE_BITS_BYTE + transactions * PROFILE_BITS_FRAME;
+  return (bits * 1000000UL + clock - 1) / clock;
+}
+
+void profile(gbj_bh1750::Modes mode, uint8_t mtreg)
+{
+  gbj_bh1750::Profile config;
+  sensor.makeProfile(config, mode, mtreg);
+  if (sensor.isError(sensor.setProfile(config)))
+  {
+    return;
+  }
+  uint32_t latencySum = 0, latencyMax = 0;
+  uint8_t samples = 0;
+  for (uint8_t i = 0; i < PROFILE_SAMPLES; i++)
+  {
+    uint32_t timeStart = micros();
+    if (sensor.isError(sensor.measureLight()))
+    {
+      continue;
+    }
+    uint32_t latency = micros() - timeStart;
+    latencySum += latency;
+    latencyMax = max(latencyMax, latency);
+    samples++;
+  }
+  // Reading of data register plus measurement instruction in one time modes
+  bool onetime = mode & 0x20;
+  uint8_t transactions = onetime ? 2 : 1;
+  uint8_t bytes = onetime ? 5 : 3;
+  uint32_t latency = samples ? latencySum / samples : 0;
+  // Sensor powers down after conversion in one time modes only
+  uint32_t active = onetime ? 1000UL * sensor.getMeasurementTimeTyp() : latency;
+  char line[128];
+  snprintf(line,
+           sizeof(line),
+           "0x%02X,%u,%lu,%lu,%lu,%lu,%u,%u,%lu,%lu,%lu",
+           mode,
+           config.mtreg,
+           static_cast<unsigned long>(sensor.getSensitivityMilliTyp()),
+           static_cast<unsigned long>(sensor.getMeasurementTimeMicros()),
+           static_cast<unsigned long>(latency),
+           static_cast<unsigned long>(latencyMax),
+           samples,
+           bytes,
+           busTime(transactions, bytes, gbj_bh1750::CLOCK_100KHZ),
+           busTime(transactions, bytes, gbj_bh1750::CLOCK_400KHZ),
+           static_cast<unsigned long>(active * PROFILE_CURRENT / 1000 *
+                                      PROFILE_VOLTAGE / 1000));
+  output(line);
+}
+
+void setup()
+{
+#if !defined(GBJ_BH1750_TRANSPORT_SIM) && !defined(GBJ_BH1750_TRANSPORT_LINUX)
+  Serial.begin(9600);
+#endif
+#if defined(GBJ_BH1750_TRANSPORT_SIM)
+  sensor.setSimLight(500);
+#endif
+  if (sensor.isError(sensor.begin()))
+  {
+    output("Begin failed");
+    return;
+  }
+  output("mode,mtreg,sense_mlx,time_us,latency_avg_us,latency_max_us,samples,"
+         "bus_bytes,bus_100k_us,bus_400k_us,energy_nj");
+  for (uint8_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+  {
+    // Low resolution modes ignore measurement time register
+    if ((modes[m] & 0x03) == 0x03)
+    {
+      profile(modes[m], PROFILE_MTREG_TYP);
+      continue;
+    }
+    for (uint16_t mtreg = PROFILE_MTREG_MIN; mtreg < PROFILE_MTREG_MAX;
+         mtreg += PROFILE_MTREG_STEP)
+    {
+      profile(modes[m], mtreg);
+    }
+    profile(modes[m], PROFILE_MTREG_MAX);
+  }
+  sensor.powerOff();
+}
+
+void loop() {}
+
+#if defined(GBJ_BH1750_TRANSPORT_SIM) || defined(GBJ_BH1750_TRANSPORT_LINUX)
+int main()
+{
+  setup();
+  return 0;
+}
+#endif
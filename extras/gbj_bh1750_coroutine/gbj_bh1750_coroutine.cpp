@@ -0,0 +1,106 @@
+/*
+  NAME:
+  Coroutine measurements of gbjBH1750 library on the simulator.
+
+  DESCRIPTION:
+  The host program runs two simulated sensors at different addresses by the
+  executor of C++20 coroutines, each one in its own task awaiting
+  measurements by co_await sensor.measure().
+  - The dim sensor measures in one time high resolution mode with long
+    conversion time, the bright one in continuous low resolution mode with
+    short conversion time. Both tasks pause between measurements by
+    co_await executor.delay().
+  - Each measurement is printed with virtual time of its finish. Because
+    conversions overlap, the total virtual time is shorter than the sum of
+    both tasks running one after another, which is printed as well.
+  - The program exits with nonzero status at any failed measurement or if
+    the conversions have not overlapped.
+  - Build on the host with the simulator transport and C++20, e.g.,
+    g++ -std=c++20 -DGBJ_BH1750_TRANSPORT_SIM -Isrc
+      extras/gbj_bh1750_coroutine/gbj_bh1750_coroutine.cpp
+      src/gbj_bh1750*.cpp
+  - Usage: gbj_bh1750_coroutine [measurements]
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+*/
+#if !defined(GBJ_BH1750_TRANSPORT_SIM)
+  #error The coroutine demonstration runs on the simulator transport only
+#endif
+#include "gbj_bh1750_executor.h"
+#if !defined(__cpp_impl_coroutine)
+  #error The coroutine demonstration requires C++20 coroutines
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#define COROUTINE_DIM 100 // Simulated light of the dim sensor in lux
+#define COROUTINE_BRIGHT 2000 // Simulated light of the bright sensor in lux
+#define COROUTINE_PAUSE 100 // Pause between measurements in milliseconds
+#define COROUTINE_MEASUREMENTS 3 // Default number of measurements per task
+
+gbj_bh1750 dim = gbj_bh1750();
+gbj_bh1750 bright = gbj_bh1750();
+gbj_bh1750_executor::Slot slots[2];
+gbj_bh1750_executor executor(slots, sizeof(slots) / sizeof(slots[0]));
+
+uint8_t failures;
+uint32_t busy; // Virtual time of tasks running sequentially in microseconds
+
+gbj_bh1750_executor::Task monitor(gbj_bh1750 &sensor,
+                                  const char *name,
+                                  uint8_t measurements)
+{
+  uint32_t timeStart = micros();
+  for (uint8_t i = 0; i < measurements; i++)
+  {
+    gbj_bh1750::ResultCodes result = co_await sensor.measure();
+    if (sensor.isError(result))
+    {
+      failures++;
+      printf("%8lu us %s: error %u\n",
+             static_cast<unsigned long>(micros()),
+             name,
+             result);
+    }
+    else
+    {
+      printf("%8lu us %s: %lu mlx\n",
+             static_cast<unsigned long>(micros()),
+             name,
+             static_cast<unsigned long>(sensor.getLightMilliLuxTyp()));
+    }
+    co_await executor.delay(COROUTINE_PAUSE);
+  }
+  busy += micros() - timeStart;
+}
+
+int main(int argc, char *argv[])
+{
+  uint8_t measurements = argc > 1 ? atoi(argv[1]) : COROUTINE_MEASUREMENTS;
+  dim.setSimLight(COROUTINE_DIM);
+  bright.setSimAddress(gbj_bh1750::Addresses::ADDRESS_VCC);
+  bright.setSimLight(COROUTINE_BRIGHT);
+  if (dim.isError(dim.begin(gbj_bh1750::Addresses::ADDRESS_GND,
+                            gbj_bh1750::Modes::MODE_ONETIME_HIGH)) ||
+      bright.isError(bright.begin(gbj_bh1750::Addresses::ADDRESS_VCC,
+                                  gbj_bh1750::Modes::MODE_CONTINUOUS_LOW)))
+  {
+    printf("sensor not initialized\n");
+    return 1;
+  }
+  uint32_t timeStart = micros();
+  executor.spawn(monitor(dim, "dim", measurements));
+  executor.spawn(monitor(bright, "bright", measurements));
+  executor.runAll();
+  uint32_t elapsed = micros() - timeStart;
+  printf("failures %u, elapsed %lu us, sequential %lu us\n",
+         failures,
+         static_cast<unsigned long>(elapsed),
+         static_cast<unsigned long>(busy));
+  return failures || (busy && elapsed >= busy) ? 1 : 0;
+}
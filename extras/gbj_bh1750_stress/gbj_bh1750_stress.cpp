@@ -0,0 +1,260 @@
+/*
+  NAME:
+  Fault-injection stress harness of gbjBH1750 library on the simulator.
+
+  DESCRIPTION:
+  The host program runs a random sequence of operations, i.e., begin(),
+  reset(), setMode(), setting measurement time register, and measureLight(),
+  on the simulated sensor with bus faults injected at random, i.e., NACKs,
+  timeouts, and corrupted reads at configurable rates.
+  - After each operation it checks consistency of the library state with the
+    simulated sensor. The bus stop flag must be restored after any operation
+    and after a successful operation the sensor must run in the mode and with
+    the measurement time register the library reports.
+  - A sample is valid, if it is measured successfully and does not differ
+    from the simulated light more than by 2% or two resolution steps.
+    Corrupted reads cannot be detected by the master, so that an invalid
+    sample is counted as corrupted, if a corrupted read has been injected
+    during its measurement. Otherwise it is an inconsistency.
+  - Recovery latency is the virtual time from a failed operation to the
+    next valid sample.
+  - The program exits with nonzero status at any inconsistency.
+  - Build on the host with the simulator transport, e.g.,
+    g++ -DGBJ_BH1750_TRANSPORT_SIM -Isrc
+      extras/gbj_bh1750_stress/gbj_bh1750_stress.cpp src/gbj_bh1750*.cpp
+  - Usage: gbj_bh1750_stress [nack% [timeout% [corrupt% [operations
+    [seed]]]]]
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+*/
+#if !defined(GBJ_BH1750_TRANSPORT_SIM)
+  #error The stress harness runs on the simulator transport only
+#endif
+#include "gbj_bh1750.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define STRESS_LIGHT 500 // Simulated light in lux
+#define STRESS_NACK 5 // Default rate of NACKs in percent
+#define STRESS_TIMEOUT 1 // Default rate of timeouts in percent
+#define STRESS_CORRUPT 1 // Default rate of corrupted reads in percent
+#define STRESS_OPERATIONS 10000 // Default number of operations
+#define STRESS_TOLERANCE 2 // Tolerance of a valid sample in percent
+#define STRESS_STEPS 2 // Tolerance of a valid sample in resolution steps
+
+enum Operations : uint8_t
+{
+  OP_BEGIN,
+  OP_RESET,
+  OP_MODE,
+  OP_MTREG,
+  OP_MEASURE,
+  OP_COUNT,
+};
+
+const char *opNames[] = { "begin", "reset", "setMode", "setResolution",
+                          "measureLight" };
+
+const gbj_bh1750::Modes modes[] = {
+  gbj_bh1750::MODE_CONTINUOUS_HIGH, gbj_bh1750::MODE_CONTINUOUS_HIGH2,
+  gbj_bh1750::MODE_CONTINUOUS_LOW,  gbj_bh1750::MODE_ONETIME_HIGH,
+  gbj_bh1750::MODE_ONETIME_HIGH2,   gbj_bh1750::MODE_ONETIME_LOW,
+};
+
+gbj_bh1750 sensor = gbj_bh1750();
+
+struct Stats
+{
+  uint32_t operations[OP_COUNT];
+  uint32_t failures[OP_COUNT];
+  uint32_t inconsistencies;
+  uint32_t samples; // Valid samples
+  uint32_t corrupted; // Successful but invalid samples
+  uint32_t recoveries;
+  uint32_t recoverySum; // In microseconds
+  uint32_t recoveryMax;
+} stats;
+
+uint32_t seed;
+
+uint32_t random(uint32_t range)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 16) % range;
+}
+
+uint8_t argument(int argc, char *argv[], int index, uint8_t value)
+{
+  return index < argc ? atoi(argv[index]) : value;
+}
+
+// Run an operation and return its success
+bool operate(Operations op)
+{
+  gbj_bh1750::Modes mode = modes[random(sizeof(modes) / sizeof(modes[0]))];
+  switch (op)
+  {
+    case OP_BEGIN:
+      return sensor.isSuccess(sensor.begin(sensor.ADDRESS_GND, mode));
+    case OP_RESET:
+      return sensor.isSuccess(sensor.reset());
+    case OP_MODE:
+      return sensor.isSuccess(sensor.setMode(mode));
+    case OP_MTREG:
+      switch (random(3))
+      {
+        case 0:
+          return sensor.isSuccess(sensor.setResolutionMin());
+        case 1:
+          return sensor.isSuccess(sensor.setResolutionTyp());
+        default:
+          return sensor.isSuccess(sensor.setResolutionMax());
+      }
+    default:
+      return sensor.isSuccess(sensor.measureLight());
+  }
+}
+
+// Check state of the library against the simulated sensor
+bool consistent(Operations op, bool success, uint32_t index)
+{
+  if (!sensor.getBusStop())
+  {
+    printf("%lu,%s: bus stop flag not restored\n",
+           static_cast<unsigned long>(index),
+           opNames[op]);
+    return false;
+  }
+  if (!success)
+  {
+    return true;
+  }
+  gbj_bh1750::Profile profile;
+  sensor.getProfile(profile);
+  // Sensor powers down after conversion in one time modes
+  bool onetime = profile.mode & 0x20;
+  bool modeValid = sensor.getSimMode() == profile.mode ||
+                   (onetime && !sensor.getSimMode());
+  if (sensor.getSimMtreg() != profile.mtreg || !modeValid)
+  {
+    printf("%lu,%s: library mode 0x%02X mtreg %u, sensor mode 0x%02X mtreg "
+           "%u\n",
+           static_cast<unsigned long>(index),
+           opNames[op],
+           profile.mode,
+           profile.mtreg,
+           sensor.getSimMode(),
+           sensor.getSimMtreg());
+    return false;
+  }
+  return true;
+}
+
+// Measured light within tolerance of the simulated one
+bool valid()
+{
+  uint32_t expected = 1000UL * STRESS_LIGHT;
+  uint32_t measured = sensor.getLightMilliLuxTyp();
+  uint32_t deviation =
+    measured > expected ? measured - expected : expected - measured;
+  uint32_t tolerance = expected / 100 * STRESS_TOLERANCE +
+                       STRESS_STEPS * sensor.getLightResolutionMilli();
+  return deviation <= tolerance;
+}
+
+int main(int argc, char *argv[])
+{
+  uint8_t nack = argument(argc, argv, 1, STRESS_NACK);
+  uint8_t timeout = argument(argc, argv, 2, STRESS_TIMEOUT);
+  uint8_t corrupt = argument(argc, argv, 3, STRESS_CORRUPT);
+  uint32_t operations = argc > 4 ? atol(argv[4]) : STRESS_OPERATIONS;
+  seed = argc > 5 ? atol(argv[5]) : 1;
+  sensor.setSimLight(STRESS_LIGHT);
+  sensor.setSimFaults(nack, timeout, corrupt, seed);
+  bool started = false, failed = false;
+  uint32_t failStart = 0;
+  for (uint32_t i = 0; i < operations; i++)
+  {
+    // Sensor is initialized first
+    Operations op =
+      started ? static_cast<Operations>(random(OP_COUNT)) : OP_BEGIN;
+    uint32_t corruptions = sensor.getSimCorruptions();
+    bool success = operate(op);
+    started |= success;
+    stats.operations[op]++;
+    if (!consistent(op, success, i))
+    {
+      stats.inconsistencies++;
+    }
+    if (!success)
+    {
+      stats.failures[op]++;
+      if (!failed)
+      {
+        failed = true;
+        failStart = micros();
+      }
+      continue;
+    }
+    if (op != OP_MEASURE)
+    {
+      continue;
+    }
+    if (!valid())
+    {
+      if (sensor.getSimCorruptions() != corruptions)
+      {
+        stats.corrupted++;
+      }
+      else
+      {
+        printf("%lu,%s: invalid sample %lu mlx without corrupted read\n",
+               static_cast<unsigned long>(i),
+               opNames[op],
+               static_cast<unsigned long>(sensor.getLightMilliLuxTyp()));
+        stats.inconsistencies++;
+      }
+      continue;
+    }
+    stats.samples++;
+    if (failed)
+    {
+      uint32_t recovery = micros() - failStart;
+      failed = false;
+      stats.recoveries++;
+      stats.recoverySum += recovery;
+      stats.recoveryMax = max(stats.recoveryMax, recovery);
+    }
+  }
+  printf("nack %u%%, timeout %u%%, corrupt %u%%, faults %lu, time %lu ms\n",
+         nack,
+         timeout,
+         corrupt,
+         static_cast<unsigned long>(sensor.getSimFaults()),
+         static_cast<unsigned long>(millis()));
+  printf("operation,runs,failures\n");
+  for (uint8_t op = 0; op < OP_COUNT; op++)
+  {
+    printf("%s,%lu,%lu\n",
+           opNames[op],
+           static_cast<unsigned long>(stats.operations[op]),
+           static_cast<unsigned long>(stats.failures[op]));
+  }
+  printf("valid samples %lu, corrupted samples %lu\n",
+         static_cast<unsigned long>(stats.samples),
+         static_cast<unsigned long>(stats.corrupted));
+  printf("recoveries %lu, latency avg %lu us, max %lu us, unrecovered %u\n",
+         static_cast<unsigned long>(stats.recoveries),
+         static_cast<unsigned long>(
+           stats.recoveries ? stats.recoverySum / stats.recoveries : 0),
+         static_cast<unsigned long>(stats.recoveryMax),
+         failed ? 1 : 0);
+  printf("inconsistencies %lu\n",
+         static_cast<unsigned long>(stats.inconsistencies));
+  return stats.inconsistencies ? 1 : 0;
+}
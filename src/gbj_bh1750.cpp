@@ -1,4 +1,6 @@
 #include "gbj_bh1750.h"
+#include <stddef.h>
+#include <string.h>
 
 gbj_bh1750::ResultCodes gbj_bh1750::setAddress(Addresses address)
 {
@@ -14,79 +16,247 @@ gbj_bh1750::ResultCodes gbj_bh1750::setAddress(Addresses address)
   return registerAddress(address);
 }
 
-gbj_bh1750::ResultCodes gbj_bh1750::setResolutionVal(MeasurementTiming mtreg)
+gbj_bh1750::ResultCodes gbj_bh1750::begin(const Snapshot &snapshot,
+                                          bool retained)
 {
-  switch (getMode())
+  if (snapshot.crc != crc8(reinterpret_cast<const uint8_t *>(&snapshot),
+                           offsetof(Snapshot, crc)))
   {
-    // Set to default at low resolution mode
-    case Modes::MODE_CONTINUOUS_LOW:
-    case Modes::MODE_ONETIME_LOW:
-      mtreg = MeasurementTiming::MTREG_TYP;
-      break;
-    default:
-      mtreg = mtreg ? mtreg : MeasurementTiming::MTREG_TYP;
-      mtreg = constrain(
-        mtreg, MeasurementTiming::MTREG_MIN, MeasurementTiming::MTREG_MAX);
-      break;
+    return begin();
   }
-  // Send to the bus at change only
-  if (status_.mtreg != mtreg)
+  if (isError(gbj_bh1750_bus::begin()))
   {
-    status_.mtreg = mtreg;
-    bool origBusStop = getBusStop();
-    // High 3 bits
-    uint8_t mtregByte = Commands::CMD_MTIME_HIGH | (status_.mtreg >> 5);
-    setBusRpte();
-    if (isError(busSend(mtregByte)))
+    return getLastResult();
+  }
+  if (isError(setAddress(static_cast<Addresses>(snapshot.address))))
+  {
+    return getLastResult();
+  }
+  const Profile &profile = snapshot.profile;
+  Modes mode = static_cast<Modes>(profile.mode);
+  MeasurementTiming mtreg = static_cast<MeasurementTiming>(profile.mtreg);
+  bool flagMtreg = !retained && mtreg != MeasurementTiming::MTREG_TYP;
+  bool flagMode = !(mode & 0x20);
+  if (isError(sendConfig(mode, mtreg, flagMtreg, flagMode)))
+  {
+    return getLastResult();
+  }
+  storeProfile(profile);
+  startConversion();
+  notify(Events::EVENT_CONFIG);
+  return getLastResult();
+}
+
+void gbj_bh1750::getSnapshot(Snapshot &snapshot)
+{
+  memset(&snapshot, 0, sizeof(snapshot));
+  getProfile(snapshot.profile);
+  snapshot.address = getAddress();
+  snapshot.crc = crc8(reinterpret_cast<const uint8_t *>(&snapshot),
+                      offsetof(Snapshot, crc));
+}
+
+void gbj_bh1750::makeProfile(Profile &profile,
+                             Modes mode,
+                             uint8_t mtreg,
+                             bool timingMax)
+{
+  Status origStatus = status_;
+  storeMode(sanitizeMode(mode));
+  status_.mtreg = sanitizeMtreg(getMode(), mtreg);
+  status_.flagMaxMeasurementTime = timingMax;
+  storeDerived();
+  getProfile(profile);
+  status_ = origStatus;
+}
+
+void gbj_bh1750::getProfile(Profile &profile)
+{
+#if !defined(GBJ_BH1750_NOFLOAT)
+  profile.senseCoef = getSenseCoef();
+#endif
+  profile.conversionTime = getMeasurementTimeMicros();
+  profile.measurementTimeTyp = getMeasurementTimeTyp();
+  profile.measurementTimeMax = getMeasurementTimeMax();
+  profile.mode = getMode();
+  profile.mtreg = status_.mtreg;
+  profile.flagMaxMeasurementTime = status_.flagMaxMeasurementTime;
+  profile.timingCal = status_.timingCal;
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750::setProfile(const Profile &profile)
+{
+  Modes mode = static_cast<Modes>(profile.mode);
+  MeasurementTiming mtreg = static_cast<MeasurementTiming>(profile.mtreg);
+  bool flagMtreg = mtreg != status_.mtreg;
+  bool flagMode = !(mode & 0x20) && (flagMtreg || mode != getMode());
+  bool changed = flagMtreg || mode != getMode() ||
+                 profile.conversionTime != getMeasurementTimeMicros();
+  if (isError(sendConfig(mode, mtreg, flagMtreg, flagMode)))
+  {
+    return getLastResult();
+  }
+  storeProfile(profile);
+  if (flagMode)
+  {
+    startConversion();
+  }
+  if (changed)
+  {
+    notify(Events::EVENT_CONFIG);
+  }
+  return getLastResult();
+}
+
+void gbj_bh1750::storeProfile(const Profile &profile)
+{
+#if defined(GBJ_BH1750_FILTER)
+  if (profile.mode != getMode() || profile.mtreg != status_.mtreg)
+  {
+    resetFilter();
+  }
+#endif
+  storeMode(static_cast<Modes>(profile.mode));
+  status_.mtreg = static_cast<MeasurementTiming>(profile.mtreg);
+  status_.flagMaxMeasurementTime = profile.flagMaxMeasurementTime;
+  status_.timingCal = profile.timingCal;
+#if !defined(GBJ_BH1750_LEAN)
+  #if !defined(GBJ_BH1750_NOFLOAT)
+  status_.senseCoef = profile.senseCoef;
+  #endif
+  status_.conversionTime = profile.conversionTime;
+  status_.measurementTimeTyp = profile.measurementTimeTyp;
+  status_.measurementTimeMax = profile.measurementTimeMax;
+#endif
+}
+
+void gbj_bh1750::attach(Observer &observer,
+                        Handler handler,
+                        void *context,
+                        uint8_t events)
+{
+  // Attaching twice would make a loop in the chain
+  detach(observer);
+  observer.handler = handler;
+  observer.context = context;
+  observer.events = events;
+  observer.next = NULL;
+  Observer **link = &observers_;
+  while (*link)
+  {
+    link = &(*link)->next;
+  }
+  *link = &observer;
+}
+
+void gbj_bh1750::detach(Observer &observer)
+{
+  for (Observer **link = &observers_; *link; link = &(*link)->next)
+  {
+    if (*link == &observer)
     {
-      return getLastResult();
+      *link = observer.next;
+      return;
     }
-    // Low 5 bits
-    mtregByte = Commands::CMD_MTIME_LOW | (status_.mtreg & B11111);
-    if (isError(busSend(mtregByte)))
+  }
+}
+
+void gbj_bh1750::notify(Events event)
+{
+  for (Observer *observer = observers_; observer; observer = observer->next)
+  {
+    if (observer->events & event)
     {
-      return getLastResult();
+      observer->handler(*this, event, observer->context);
     }
-    setBusStopFlag(origBusStop);
   }
-  // Set mode in the sensor
-  if (isError(busSend(getMode())))
+}
+
+uint8_t gbj_bh1750::probe()
+{
+  uint8_t presence = Presence::PRESENCE_NONE;
+  if (isError(gbj_bh1750_bus::begin()))
+  {
+    return presence;
+  }
+  ResultCodes resultGnd = probe(Addresses::ADDRESS_GND);
+  if (isSuccess(resultGnd))
+  {
+    presence |= Presence::PRESENCE_GND;
+  }
+  if (isSuccess(probe(Addresses::ADDRESS_VCC)))
+  {
+    presence |= Presence::PRESENCE_VCC;
+  }
+  // Success if any sensor is present, otherwise the error of the first probe
+  setLastResult(presence ? ResultCodes::SUCCESS : resultGnd);
+  return presence;
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750::setResolutionVal(MeasurementTiming mtreg,
+                                                     bool modeChanged)
+{
+  mtreg = sanitizeMtreg(getMode(), mtreg);
+  bool changed = modeChanged || mtreg != status_.mtreg;
+  // Send to the bus at change only and update status after success
+  if (isError(sendConfig(getMode(), mtreg, status_.mtreg != mtreg, true)))
   {
     return getLastResult();
   }
-  calculateSenseCoef();
-  setMeasurementTime();
-  setTimestampReceive();
+  status_.mtreg = mtreg;
+  storeDerived();
+  startConversion();
+  if (changed)
+  {
+#if defined(GBJ_BH1750_FILTER)
+    // Counts of the data register change their scale
+    resetFilter();
+#endif
+    notify(Events::EVENT_CONFIG);
+  }
   return getLastResult();
 }
 
-void gbj_bh1750::setMeasurementTime()
+uint8_t gbj_bh1750::getTimingDefault(bool flagMax)
 {
-  uint8_t defaultMeasurementTimeTyp, defaultMeasurementTimeMax;
   switch (getMode())
   {
     case Modes::MODE_CONTINUOUS_LOW:
     case Modes::MODE_ONETIME_LOW:
-      defaultMeasurementTimeTyp = Timing::TIMING_LOWRESMODE_TYP;
-      defaultMeasurementTimeMax = Timing::TIMING_LOWRESMODE_MAX;
-      break;
+      return flagMax ? Timing::TIMING_LOWRESMODE_MAX
+                     : Timing::TIMING_LOWRESMODE_TYP;
     default:
-      defaultMeasurementTimeTyp = Timing::TIMING_HIGHRESMODE_TYP;
-      defaultMeasurementTimeMax = Timing::TIMING_HIGHRESMODE_MAX;
-      break;
+      return flagMax ? Timing::TIMING_HIGHRESMODE_MAX
+                     : Timing::TIMING_HIGHRESMODE_TYP;
   }
-  status_.measurementTimeTyp = status_.senseCoef * defaultMeasurementTimeTyp;
-  status_.measurementTimeMax = status_.senseCoef * defaultMeasurementTimeMax;
-  status_.measurementTime =
-    getTimingMax() ? status_.measurementTimeMax : status_.measurementTimeTyp;
-  status_.measurementTime *= 1.0 + float(Timing::TIMING_SAFETY_PERC) / 100.0;
-  // Limit minimal value of measurement time to typical value
-  status_.measurementTime =
-    max(status_.measurementTime, defaultMeasurementTimeTyp);
-  gbj_twowire::setDelayReceive(status_.measurementTime);
 }
 
-gbj_bh1750::ResultCodes gbj_bh1750::setMode(Modes mode)
+uint32_t gbj_bh1750::calculateMeasurementTime()
+{
+  // Calibrated time already contains its safety margin
+  uint8_t percentage = status_.timingCal
+                         ? status_.timingCal
+                         : 100 + Timing::TIMING_SAFETY_PERC;
+  uint32_t conversionTime =
+    calculateConversionTime(getTimingMax() && !status_.timingCal);
+  return (conversionTime * percentage + 99) / 100;
+}
+
+void gbj_bh1750::waitConversion()
+{
+  uint32_t elapsed = micros() - timestampConversion_;
+  uint32_t conversionTime = getMeasurementTimeMicros();
+  if (elapsed >= conversionTime)
+  {
+    return;
+  }
+  uint32_t rest = conversionTime - elapsed;
+  // Microsecond delay is precise for short periods only
+  delay(rest / 1000);
+  delayMicroseconds(rest % 1000);
+}
+
+gbj_bh1750::Modes gbj_bh1750::sanitizeMode(Modes mode)
 {
   switch (mode)
   {
@@ -96,23 +266,520 @@ gbj_bh1750::ResultCodes gbj_bh1750::setMode(Modes mode)
     case Modes::MODE_ONETIME_LOW:
     case Modes::MODE_ONETIME_HIGH:
     case Modes::MODE_ONETIME_HIGH2:
-      break;
+      return mode;
     default:
-      mode = Modes::MODE_CONTINUOUS_HIGH;
-      break;
+      return Modes::MODE_CONTINUOUS_HIGH;
   }
-  status_.mode = mode;
-  switch (getMode())
+}
+
+gbj_bh1750::MeasurementTiming gbj_bh1750::sanitizeMtreg(Modes mode,
+                                                        uint8_t mtreg)
+{
+  switch (mode)
   {
+    // Set to default at low resolution mode
     case Modes::MODE_CONTINUOUS_LOW:
     case Modes::MODE_ONETIME_LOW:
-      if (setResolutionTyp())
-        return getLastResult();
-      break;
+      return MeasurementTiming::MTREG_TYP;
     default:
-      if (setResolutionVal(status_.mtreg))
-        return getLastResult();
-      break;
+      mtreg = mtreg ? mtreg : static_cast<uint8_t>(MTREG_TYP);
+      mtreg = constrain(
+        mtreg, MeasurementTiming::MTREG_MIN, MeasurementTiming::MTREG_MAX);
+      return static_cast<MeasurementTiming>(mtreg);
+  }
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750::setMode(Modes mode)
+{
+  mode = sanitizeMode(mode);
+  Modes origMode = getMode();
+  bool modeChanged = mode != origMode;
+  storeMode(mode);
+  // Low resolution modes get the default measurement time register value
+  if (isError(setResolutionVal(status_.mtreg, modeChanged)))
+  {
+    // Sensor keeps measuring in the original mode
+    storeMode(origMode);
   }
   return getLastResult();
 }
+
+gbj_bh1750::ResultCodes gbj_bh1750::measureLightHdr()
+{
+  Profile origProfile, profile;
+  getProfile(origProfile);
+  bool flagOnetime = getMode() & 0x20;
+  // Short exposure
+  makeProfile(profile,
+              flagOnetime ? Modes::MODE_ONETIME_HIGH
+                          : Modes::MODE_CONTINUOUS_HIGH,
+              MeasurementTiming::MTREG_MIN,
+              status_.flagMaxMeasurementTime);
+  uint16_t counts = 0;
+  uint16_t senseNum = MeasurementTiming::MTREG_MIN;
+  ResultCodes result = measureCounts(profile, counts);
+  // Long exposure if its expected result fits into the data register
+  uint32_t expected = Counts::COUNT_HDR;
+  if (isSuccess(result))
+  {
+    expected = static_cast<uint32_t>(counts) * 2 *
+               MeasurementTiming::MTREG_MAX / MeasurementTiming::MTREG_MIN;
+  }
+  if (expected < Counts::COUNT_HDR)
+  {
+    uint16_t countsLong = 0;
+    makeProfile(profile,
+                flagOnetime ? Modes::MODE_ONETIME_HIGH2
+                            : Modes::MODE_CONTINUOUS_HIGH2,
+                MeasurementTiming::MTREG_MAX,
+                status_.flagMaxMeasurementTime);
+    result = measureCounts(profile, countsLong);
+    // Sum of counts at sum of sensitivities weights exposures by their
+    // length, unless light has risen meanwhile and the sum would saturate
+    if (isSuccess(result) && countsLong < Counts::COUNT_MAX - counts)
+    {
+      counts += countsLong;
+      senseNum += 2 * MeasurementTiming::MTREG_MAX;
+    }
+  }
+  if (isSuccess(result))
+  {
+#if defined(GBJ_BH1750_FILTER)
+    // Merged exposures are not filtered
+    filter_.raw = counts;
+#endif
+    storeSample(counts, senseNum, calculateRange(counts));
+    notify(Events::EVENT_MEASURE);
+  }
+  else
+  {
+    markStale();
+  }
+  // Caller's configuration holds for next measurements
+  if (isError(setProfile(origProfile)))
+  {
+    return getLastResult();
+  }
+  return setLastResult(result);
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750::measureCounts(const Profile &profile,
+                                                 uint16_t &counts)
+{
+  if (isError(setProfile(profile)) || isError(measureLightStart()))
+  {
+    return getLastResult();
+  }
+  waitConversion();
+  if (isError(readCounts(counts)))
+  {
+    return getLastResult();
+  }
+  startConversion();
+  return getLastResult();
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750::measureLightRedo()
+{
+  uint8_t quality = getQuality();
+  Modes mode;
+  MeasurementTiming mtreg;
+  if (quality & Quality::QUALITY_SATURATED)
+  {
+    mode = (getMode() & 0x20) ? Modes::MODE_ONETIME_HIGH
+                              : Modes::MODE_CONTINUOUS_HIGH;
+    mtreg = MeasurementTiming::MTREG_MIN;
+  }
+  else if (quality & Quality::QUALITY_UNDERRANGE)
+  {
+    mode = (getMode() & 0x20) ? Modes::MODE_ONETIME_HIGH2
+                              : Modes::MODE_CONTINUOUS_HIGH2;
+    mtreg = MeasurementTiming::MTREG_MAX;
+  }
+  else
+  {
+    return setLastResult();
+  }
+  // Already at the safer setting
+  if (mode == getMode() && mtreg == status_.mtreg)
+  {
+    return setLastResult();
+  }
+  Profile origProfile, profile;
+  getProfile(origProfile);
+  makeProfile(profile, mode, mtreg, status_.flagMaxMeasurementTime);
+  ResultCodes result;
+  if (isSuccess(setProfile(profile)) && isSuccess(measureLightStart()))
+  {
+    result = readLight();
+  }
+  else
+  {
+    result = markStale();
+  }
+  // Caller's configuration holds for next measurements
+  if (isError(setProfile(origProfile)))
+  {
+    return getLastResult();
+  }
+  return setLastResult(result);
+}
+
+uint8_t gbj_bh1750::measureLightAll(gbj_bh1750 *const sensors[],
+                                    uint8_t count,
+                                    const Readout &readout)
+{
+  // Conversions of all sensors overlap
+  for (uint8_t i = 0; i < count; i++)
+  {
+    sensors[i]->measureLightStart();
+  }
+  uint8_t successes = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    gbj_bh1750 &sensor = *sensors[i];
+    if (sensor.isSuccess() && sensor.isSuccess(sensor.readLight()) &&
+        sensor.status_.flagQualityRedo)
+    {
+      sensor.measureLightRedo();
+    }
+    if (sensor.isSuccess())
+    {
+      successes++;
+    }
+    if (readout.results)
+    {
+      readout.results[i] = sensor.light_.result;
+    }
+    if (readout.timestamps)
+    {
+      readout.timestamps[i] = micros();
+    }
+    if (readout.qualities)
+    {
+      readout.qualities[i] = sensor.getQuality();
+    }
+    if (readout.milliLux)
+    {
+      readout.milliLux[i] = sensor.getLightMilliLuxTyp();
+    }
+#if !defined(GBJ_BH1750_NOFLOAT)
+    if (readout.lux)
+    {
+      readout.lux[i] = sensor.getLightTyp();
+    }
+#endif
+  }
+  return successes;
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750::calibrateTiming(uint8_t margin)
+{
+  Modes mode = getMode();
+  bool origBusStop = getBusStop();
+  // Clear data register
+  setBusRpte();
+  if (isError(powerOn()))
+  {
+    setBusStopFlag(origBusStop);
+    return getLastResult();
+  }
+  if (isError(busSend(Commands::CMD_RESET)))
+  {
+    setBusStopFlag(origBusStop);
+    return notifyError();
+  }
+  setBusStopFlag(origBusStop);
+  // Cleared data register waits for the next finished conversion
+  startConversion();
+  // Start continuous measurement at current resolution
+  if (isError(busSend(Modes::MODE_CONTINUOUS_HIGH | (mode & 0x03))))
+  {
+    return notifyError();
+  }
+  uint32_t timeStart = micros();
+  uint32_t timeout = 2 * calculateConversionTime(true);
+  uint32_t elapsed;
+  // Raw data register is polled, since polled values are not measurements
+  // and filtered ones would not be zero
+  uint16_t counts = 0;
+  do
+  {
+    delayMicroseconds(Timing::TIMING_CAL_STEP);
+    if (isError(readCounts(counts)))
+    {
+      return getLastResult();
+    }
+    elapsed = micros() - timeStart;
+  } while (!counts && elapsed < timeout);
+#if defined(GBJ_BH1750_FILTER)
+  // Recent samples were measured before the reset
+  resetFilter();
+#endif
+  // Implausibly short time is kept out of waiting on results
+  if (!counts || elapsed * 100 < calculateConversionTime(false) *
+                                   Timing::TIMING_CAL_MIN)
+  {
+    setLastResult(ResultCodes::ERROR_RCV_DATA);
+    return notifyError();
+  }
+  uint32_t timingCal =
+    elapsed * (100UL + margin) / calculateConversionTime(false) + 1;
+  status_.timingCal = min(timingCal, static_cast<uint32_t>(0xFF));
+  storeDerived();
+  startConversion();
+  notify(Events::EVENT_CONFIG);
+  if (mode & 0x20)
+  {
+    powerOff();
+  }
+  return getLastResult();
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750::tuneBusClock(uint8_t cycles)
+{
+#if defined(GBJ_BH1750_TRANSPORT_LINUX)
+  // Bus clock is determined by the kernel adapter driver
+  (void)cycles;
+  return setLastResult(ResultCodes::ERROR_UNSUPPORTED);
+#else
+  // From the fastest clock
+  const ClockSpeeds clocks[] = { ClockSpeeds::CLOCK_400KHZ,
+                                 ClockSpeeds::CLOCK_100KHZ };
+  uint8_t count = sizeof(clocks) / sizeof(clocks[0]);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    setBusClock(clocks[i]);
+    if (verifyBus(cycles) <= BusTuning::BUS_TUNE_FAILS)
+    {
+      return setLastResult();
+    }
+  }
+  // The slowest clock stays set even if not reliable
+  return isError() ? getLastResult()
+                   : setLastResult(ResultCodes::ERROR_RCV_DATA);
+#endif
+}
+
+uint8_t gbj_bh1750::verifyBus(uint8_t cycles)
+{
+  bool origBusStop = getBusStop();
+  uint8_t failures = 0;
+  ResultCodes result = ResultCodes::SUCCESS;
+  for (uint8_t i = 0; i < cycles && failures <= BusTuning::BUS_TUNE_FAILS;
+       i++)
+  {
+    uint8_t data[4];
+    status_.flagMtregLost = true;
+    setBusRpte();
+    if (isSuccess(busSend(Commands::CMD_MTIME_HIGH | (status_.mtreg >> 5))))
+    {
+      setBusStopFlag(origBusStop);
+      if (isSuccess(
+            busSend(Commands::CMD_MTIME_LOW | (status_.mtreg & 0x1F))))
+      {
+        status_.flagMtregLost = false;
+      }
+      if (!status_.flagMtregLost && isSuccess(busReceive(data, 2)) &&
+          isSuccess(busReceive(data + 2, 2)))
+      {
+        if (data[0] == data[2] && data[1] == data[3])
+        {
+          continue;
+        }
+        setLastResult(ResultCodes::ERROR_RCV_DATA);
+      }
+    }
+    setBusStopFlag(origBusStop);
+    result = getLastResult();
+    failures++;
+  }
+  setLastResult(result);
+  return failures;
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750::sendConfig(Modes mode,
+                                               MeasurementTiming mtreg,
+                                               bool flagMtreg,
+                                               bool flagMode)
+{
+  bool origBusStop = getBusStop();
+  setLastResult();
+  // Register with unknown content is rewritten regardless of its value
+  if (flagMtreg || status_.flagMtregLost)
+  {
+    // Sensor keeps just a part of the configuration at failure
+    status_.flagMtregLost = true;
+    // High 3 bits
+    setBusRpte();
+    if (isError(busSend(Commands::CMD_MTIME_HIGH | (mtreg >> 5))))
+    {
+      setBusStopFlag(origBusStop);
+      return notifyError();
+    }
+    // Low 5 bits finish the transaction, if no instruction follows
+    setBusStopFlag(flagMode ? false : origBusStop);
+    if (isError(busSend(Commands::CMD_MTIME_LOW | (mtreg & 0x1F))))
+    {
+      setBusStopFlag(origBusStop);
+      return notifyError();
+    }
+    setBusStopFlag(origBusStop);
+  }
+  if (flagMode && isError(busSend(mode)))
+  {
+    return notifyError();
+  }
+  status_.flagMtregLost = false;
+  return getLastResult();
+}
+
+#if defined(GBJ_BH1750_FILTER)
+bool gbj_bh1750::setFilter(Filters filter, uint8_t param)
+{
+  filter_.type = Filters::FILTER_NONE;
+  filter_.param = 0;
+  resetFilter();
+  switch (filter)
+  {
+  #if defined(GBJ_BH1750_FILTER_EMA)
+    case Filters::FILTER_EMA:
+      param = constrain(param, 1, FilterParams::FILTER_EMA_MAX);
+      break;
+  #endif
+  #if defined(GBJ_BH1750_FILTER_MEDIAN)
+    case Filters::FILTER_MEDIAN:
+      param = constrain(param, 1, FilterParams::FILTER_MEDIAN_MAX);
+      break;
+  #endif
+  #if defined(GBJ_BH1750_FILTER_KALMAN)
+    case Filters::FILTER_KALMAN:
+      param = max(param, static_cast<uint8_t>(1));
+      break;
+  #endif
+    case Filters::FILTER_NONE:
+      return true;
+    default:
+      return false;
+  }
+  filter_.type = filter;
+  filter_.param = param;
+  return true;
+}
+
+uint16_t gbj_bh1750::filterSample(uint16_t result)
+{
+  switch (filter_.type)
+  {
+  #if defined(GBJ_BH1750_FILTER_EMA)
+    case Filters::FILTER_EMA:
+    {
+      const uint8_t shift = FilterParams::FILTER_FRACTION;
+      uint32_t sample = static_cast<uint32_t>(result) << shift;
+      if (filter_.count)
+      {
+        // Subtract before adding to stay unsigned
+        filter_.estimate -= filter_.estimate >> filter_.param;
+        filter_.estimate += sample >> filter_.param;
+      }
+      else
+      {
+        filter_.count = 1;
+        filter_.estimate = sample;
+      }
+      return (filter_.estimate + (1UL << (shift - 1))) >> shift;
+    }
+  #endif
+  #if defined(GBJ_BH1750_FILTER_MEDIAN)
+    case Filters::FILTER_MEDIAN:
+    {
+      uint16_t sorted[FilterParams::FILTER_MEDIAN_MAX];
+      filter_.window[filter_.count % filter_.param] = result;
+      // Keep the count within two windows after the first one is full
+      filter_.count = filter_.count + 1 < 2 * filter_.param ? filter_.count + 1
+                                                            : filter_.param;
+      uint8_t n = min(filter_.count, filter_.param);
+      // Insertion sort of a few samples
+      for (uint8_t i = 0; i < n; i++)
+      {
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > filter_.window[i]; j--)
+        {
+          sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = filter_.window[i];
+      }
+      return sorted[(n - 1) / 2];
+    }
+  #endif
+  #if defined(GBJ_BH1750_FILTER_KALMAN)
+    case Filters::FILTER_KALMAN:
+    {
+      const uint8_t shift = FilterParams::FILTER_FRACTION;
+      const uint32_t unit = 1UL << shift;
+      uint32_t sample = static_cast<uint32_t>(result) << shift;
+      // Measurement noise in process noise units
+      uint32_t noise = static_cast<uint32_t>(filter_.param) << shift;
+      if (!filter_.count)
+      {
+        filter_.count = 1;
+        filter_.estimate = sample;
+        filter_.variance = noise;
+        return result;
+      }
+      // Prediction of constant light increases its variance by process noise
+      uint32_t variance = filter_.variance + unit;
+      uint32_t gain = (variance << shift) / (variance + noise);
+      uint32_t delta = sample >= filter_.estimate ? sample - filter_.estimate
+                                                  : filter_.estimate - sample;
+      delta = (delta >> shift) * gain + (((delta & (unit - 1)) * gain) >> shift);
+      if (sample >= filter_.estimate)
+      {
+        filter_.estimate += delta;
+      }
+      else
+      {
+        filter_.estimate -= delta;
+      }
+      filter_.variance = (variance * (unit - gain)) >> shift;
+      return (filter_.estimate + (1UL << (shift - 1))) >> shift;
+    }
+  #endif
+    default:
+      return result;
+  }
+}
+#endif
+
+uint32_t gbj_bh1750::divDecimal(uint32_t num, uint32_t den, uint8_t digits)
+{
+  uint32_t quotient = num / den;
+  uint32_t remainder = num % den;
+  // Long division digit by digit keeps the remainder within ten denominators
+  while (digits--)
+  {
+    remainder *= 10;
+    quotient = quotient * 10 + remainder / den;
+    remainder %= den;
+  }
+  if (2 * remainder >= den)
+  {
+    quotient++;
+  }
+  return quotient;
+}
+
+uint8_t gbj_bh1750::crc8(const uint8_t *data, uint8_t len)
+{
+  // Polynomial x^8 + x^2 + x + 1
+  uint8_t crc = 0xFF;
+  while (len--)
+  {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
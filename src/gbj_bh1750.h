@@ -9,6 +9,21 @@
     programatically accordingly as well as measurement mode.
   - Library has been inspired by the Christopher Laws's library BH1750-master
     version 1.1.3 but totally redesigned and rewritten.
+  - Library is built on the bus transport selected at compile time, which is
+    the two-wire library gbj_twowire by default.
+  - Build flag GBJ_BH1750_LEAN selects lean memory profile, which stores just
+    packed mode, measurement time register, flags, and the data register
+    value. Sensitivity coefficient, measurement times, and light intensities
+    are calculated on demand at their retrieval.
+  - Build flag GBJ_BH1750_NOFLOAT removes all floating point code, so that
+    just the integer interface in milli-lux is available.
+  - Observers registered by a caller are notified about completed
+    measurements, configuration changes, and errors.
+  - With C++20 coroutines the measurement can be awaited by a coroutine,
+    which is suspended for conversion time instead of blocking.
+  - Build flags GBJ_BH1750_FILTER_EMA, GBJ_BH1750_FILTER_MEDIAN, and
+    GBJ_BH1750_FILTER_KALMAN compile in corresponding digital filters of
+    the data register value, which can be selected for an instance object.
 
   LICENSE:
   This program is free software; you can redistribute it and/or modify
@@ -23,9 +38,18 @@
 #ifndef GBJ_BH1750_H
 #define GBJ_BH1750_H
 
-#include "gbj_twowire.h"
+#include "gbj_bh1750_bus.h"
+#include <string.h>
+#if defined(__cpp_impl_coroutine)
+  #include <coroutine>
+#endif
+
+#if defined(GBJ_BH1750_FILTER_EMA) || defined(GBJ_BH1750_FILTER_MEDIAN) || \
+  defined(GBJ_BH1750_FILTER_KALMAN)
+  #define GBJ_BH1750_FILTER
+#endif
 
-class gbj_bh1750 : public gbj_twowire
+class gbj_bh1750 : public gbj_bh1750_bus
 {
 public:
   enum Addresses : uint8_t
@@ -46,11 +70,98 @@ public:
     MODE_ONETIME_LOW = 0x23, // 4 lx / 16 ms
   };
 
+  enum Presence : uint8_t
+  {
+    PRESENCE_NONE = 0,
+    PRESENCE_GND = 1, // Sensor responds at address ADDRESS_GND
+    PRESENCE_VCC = 2, // Sensor responds at address ADDRESS_VCC
+  };
+  // Bit flags about quality of the recent measurement result
+  enum Quality : uint8_t
+  {
+    QUALITY_OK = 0,
+    QUALITY_STALE = 1, // Recent measurement failed, result is older one
+    QUALITY_AFTER_ERROR = 2, // First result after failed communication
+    QUALITY_SATURATED = 4, // Data register at its maximum
+    QUALITY_UNDERRANGE = 8, // Too few counts for reasonable precision
+  };
+  // Digital filters of the data register value
+  enum Filters : uint8_t
+  {
+    FILTER_NONE = 0,
+    FILTER_EMA = 1, // Exponential moving average
+    FILTER_MEDIAN = 2, // Median of recent samples for spike rejection
+    FILTER_KALMAN = 3, // Kalman filter of constant light with noise
+  };
+
+  // Bit flags of events notified to observers
+  enum Events : uint8_t
+  {
+    EVENT_MEASURE = 1, // Measurement result read successfully
+    EVENT_CONFIG = 2, // Configuration of the sensor changed
+    EVENT_ERROR = 4, // Communication with the sensor failed
+    EVENT_ALL = 7,
+  };
+  typedef void (*Handler)(gbj_bh1750 &sensor, Events event, void *context);
+  // Node of the observer chain owned by a caller
+  struct Observer
+  {
+    Handler handler;
+    void *context;
+    uint8_t events; // Bit flags of observed events
+    Observer *next;
+  };
+
+  // Measurement configuration with precomputed derived values
+  struct Profile
+  {
+#if !defined(GBJ_BH1750_NOFLOAT)
+    float senseCoef; // Sensitivity coeficient
+#endif
+    uint32_t conversionTime; // In microseconds including safety margin
+    uint16_t measurementTimeTyp; // In milliseconds
+    uint16_t measurementTimeMax; // In milliseconds
+    uint8_t mode; // Measurement mode
+    uint8_t mtreg; // Value of measurement time register
+    uint8_t flagMaxMeasurementTime;
+    uint8_t timingCal; // Calibrated percentage of typical conversion time
+  };
+  // Caller-owned arrays of bulk readout with an element per sensor
+  struct Readout
+  {
+    uint16_t *results; // Data register values
+    uint32_t *timestamps; // Times of reading in microseconds
+    uint8_t *qualities; // Quality flags
+    uint32_t *milliLux; // Light in milli-lux at typical accuracy
+#if !defined(GBJ_BH1750_NOFLOAT)
+    float *lux; // Light in lux at typical accuracy
+#endif
+  };
+  // Configuration for storing in RTC memory or EEPROM
+  struct Snapshot
+  {
+    Profile profile;
+    uint8_t address; // Registered address of the sensor
+    uint8_t crc; // Checksum of all preceding members
+  };
+
   gbj_bh1750(ClockSpeeds clockSpeed = ClockSpeeds::CLOCK_100KHZ,
              uint8_t pinSDA = 4,
              uint8_t pinSCL = 5)
-    : gbj_twowire(clockSpeed, pinSDA, pinSCL)
+    : gbj_bh1750_bus(clockSpeed, pinSDA, pinSCL)
   {
+    observers_ = NULL;
+    timestampConversion_ = 0;
+    // No garbage even in not statically allocated instance objects
+    memset(&status_, 0, sizeof(status_));
+    memset(&light_, 0, sizeof(light_));
+#if defined(GBJ_BH1750_FILTER)
+    memset(&filter_, 0, sizeof(filter_));
+#endif
+    storeMode(Modes::MODE_CONTINUOUS_HIGH);
+    status_.mtreg = MeasurementTiming::MTREG_TYP;
+    storeDerived();
+    light_.senseNum = calculateSenseNum();
   }
 
   /*
@@ -79,7 +190,7 @@ public:
   inline ResultCodes begin(Addresses address = Addresses::ADDRESS_GND,
                            Modes mode = Modes::MODE_CONTINUOUS_HIGH)
   {
-    if (isError(gbj_twowire::begin()))
+    if (isError(gbj_bh1750_bus::begin()))
     {
       return getLastResult();
     }
@@ -91,13 +202,220 @@ public:
     {
       return getLastResult();
     }
-    if (isError(setMode(mode)))
+    Modes origMode = getMode();
+    storeMode(sanitizeMode(mode));
+    // Observers learn the configuration even if it is the default one
+    if (isError(setResolutionVal(status_.mtreg, true)))
     {
-      return getLastResult();
+      storeMode(origMode);
     }
     return getLastResult();
   }
 
+  /*
+    Initialize two wire bus and sensor from stored configuration.
+
+    DESCRIPTION:
+    The method restores the configuration saved by getSnapshot() including
+    its derived values without their recalculation and sends only those
+    commands to the sensor, which are needed for reaching the configuration.
+    - If the sensor retained its configuration, e.g., it has been just put to
+      power down, it gets only the measurement instruction in continuous mode.
+    - Otherwise the measurement time register is written only if it differs
+      from its power on value.
+    - In one time modes the measurement instruction is sent at measurement.
+    - If the snapshot is corrupted, the method falls back to the begin()
+      with default parameters.
+
+    PARAMETERS:
+    snapshot - Configuration stored by the method getSnapshot().
+      - Data type: Snapshot
+      - Default value: none
+      - Limited range: none
+
+    retained - Flag about the sensor kept its configuration since snapshot.
+      - Data type: bool
+      - Default value: false
+      - Limited range: true, false
+
+    RETURN: Result code
+  */
+  ResultCodes begin(const Snapshot &snapshot, bool retained = false);
+
+  /*
+    Store current configuration.
+
+    PARAMETERS:
+    snapshot - Structure to be filled with configuration and its checksum.
+      - Data type: Snapshot
+      - Default value: none
+      - Limited range: none
+
+    RETURN: none
+  */
+  void getSnapshot(Snapshot &snapshot);
+
+  /*
+    Precompute configuration profile.
+
+    DESCRIPTION:
+    The method sanitizes the parameters as corresponding setters do and
+    calculates all values derived from them without any communication with
+    the sensor and without changing current configuration.
+    - Current calibration of conversion time is used for the profile.
+
+    PARAMETERS:
+    profile - Structure to be filled with the configuration.
+      - Data type: Profile
+      - Default value: none
+      - Limited range: none
+
+    mode - Measurement mode from possible listed ones.
+      - Data type: Modes
+      - Default value: none
+      - Limited range: MODE_CONTINUOUS_HIGH ~ MODE_ONETIME_LOW
+
+    mtreg - Value of measurement time register, ignored in low modes.
+      - Data type: non-negative integer
+      - Default value: 69
+      - Limited range: 31 ~ 254
+
+    timingMax - Flag about using maximal measurement times.
+      - Data type: bool
+      - Default value: false
+      - Limited range: true, false
+
+    RETURN: none
+  */
+  void makeProfile(Profile &profile,
+                   Modes mode,
+                   uint8_t mtreg = MeasurementTiming::MTREG_TYP,
+                   bool timingMax = false);
+
+  /*
+    Capture current configuration as a profile.
+
+    PARAMETERS:
+    profile - Structure to be filled with the configuration.
+      - Data type: Profile
+      - Default value: none
+      - Limited range: none
+
+    RETURN: none
+  */
+  void getProfile(Profile &profile);
+
+  /*
+    Switch to the configuration profile at once.
+
+    DESCRIPTION:
+    The method sends to the sensor just the commands needed for reaching the
+    profile from current configuration and only after their success it takes
+    over the profile including its derived values.
+    - The measurement time register is written only at its change.
+    - The measurement instruction is sent only in continuous modes at change
+      of the mode or the measurement time register. In one time modes it is
+      sent at measurement anyway.
+
+    PARAMETERS:
+    profile - Configuration prepared by makeProfile() or getProfile().
+      - Data type: Profile
+      - Default value: none
+      - Limited range: none
+
+    RETURN: Result code
+  */
+  ResultCodes setProfile(const Profile &profile);
+
+  /*
+    Register observer of events.
+
+    DESCRIPTION:
+    The handler is called at completion of an event, so that processing
+    stages like logging, filtering, or transmission can be chained without
+    polling. Observers are notified in order of their attaching.
+    - Measurement event is notified at every successful reading of the data
+      register by measuring methods, i.e., for both measurements at automatic
+      redo, but once for the merged result of measureLightHdr().
+    - Configuration event is notified at actual change of the mode or the
+      measurement time register, at restoring of a configuration, and at
+      timing calibration.
+    - Error event is notified at every failed communication with the sensor
+      except probing. The handler can get the error by getLastResult().
+    - The handler should not call measuring or configuration methods of the
+      sensor, otherwise it is called recursively.
+    - The node of the chain is owned by a caller and should exist while it is
+      attached, so that no memory is allocated.
+
+    PARAMETERS:
+    observer - Node of the observer chain.
+      - Data type: Observer
+      - Default value: none
+      - Limited range: none
+
+    handler - Function called at events.
+      - Data type: Handler
+      - Default value: none
+      - Limited range: none
+
+    context - Arbitrary pointer passed to the handler.
+      - Data type: pointer
+      - Default value: NULL
+      - Limited range: none
+
+    events - Bit flags of observed events.
+      - Data type: non-negative integer
+      - Default value: EVENT_ALL
+      - Limited range: EVENT_MEASURE ~ EVENT_ALL
+
+    RETURN: none
+  */
+  void attach(Observer &observer,
+              Handler handler,
+              void *context = NULL,
+              uint8_t events = Events::EVENT_ALL);
+
+  /*
+    Remove observer from the chain.
+
+    PARAMETERS:
+    observer - Attached node of the observer chain.
+      - Data type: Observer
+      - Default value: none
+      - Limited range: none
+
+    RETURN: none
+  */
+  void detach(Observer &observer);
+
+  /*
+    Detect sensors on the bus.
+
+    DESCRIPTION:
+    The method initiates the bus and checks both possible addresses of the
+    sensor by address only transactions without changing the sensor state.
+    - It is useful for skipping full initialization of missing sensors.
+    - The registered address of the instance object is not changed.
+
+    PARAMETERS: none
+
+    RETURN: Bit mask of present sensors composed of Presence values
+  */
+  uint8_t probe();
+
+  /*
+    Check presence of a sensor at particular address.
+
+    PARAMETERS:
+    address - One of two possible 7 bit addresses of the sensor.
+      - Data type: Addresses
+      - Default value: none
+      - Limited range: ADDRESS_GND, ADDRESS_VCC
+
+    RETURN: Result code, success if the sensor acknowledged the address
+  */
+  inline ResultCodes probe(Addresses address) { return busProbe(address); }
+
   /*
     Activate sensor.
 
@@ -108,7 +426,14 @@ public:
 
     RETURN: Result code
   */
-  inline ResultCodes powerOn() { return busSend(CMD_POWER_ON); }
+  inline ResultCodes powerOn()
+  {
+    if (isError(busSend(CMD_POWER_ON)))
+    {
+      return notifyError();
+    }
+    return getLastResult();
+  }
 
   /*
     Deactivate sensor.
@@ -120,7 +445,14 @@ public:
 
     RETURN: Result code
   */
-  inline ResultCodes powerOff() { return busSend(CMD_POWER_DOWN); }
+  inline ResultCodes powerOff()
+  {
+    if (isError(busSend(CMD_POWER_DOWN)))
+    {
+      return notifyError();
+    }
+    return getLastResult();
+  }
 
   /*
     Reset sensor.
@@ -139,30 +471,89 @@ public:
     setBusRpte();
     if (isError(powerOn()))
     {
+      setBusStopFlag(origBusStop);
       return getLastResult();
     }
     if (isError(busSend(Commands::CMD_RESET)))
     {
-      return getLastResult();
+      setBusStopFlag(origBusStop);
+      return notifyError();
     }
     setBusStopFlag(origBusStop);
-    if (isError(setMode(getMode())))
+    // Cleared data register waits for the next finished conversion even if
+    // resending the mode fails
+    startConversion();
+    return setMode(getMode());
+  }
+
+  /*
+    Measure ambient light intensity in lux.
+
+    DESCRIPTION: none
+
+    PARAMETERS: none
+
+    RETURN: Result code
+  */
+  inline ResultCodes measureLight()
+  {
+    if (isError(measureLightStart()))
+    {
+      return markStale();
+    }
+    if (isError(readLight()))
     {
       return getLastResult();
     }
+    if (status_.flagQualityRedo)
+    {
+      return measureLightRedo();
+    }
     return getLastResult();
   }
 
   /*
-    Measure ambient light intensity in lux.
+    Repeat the recent measurement at a safer setting if its quality is bad.
 
-    DESCRIPTION: none
+    DESCRIPTION:
+    If the recent result is saturated, the method measures again in high
+    resolution mode with minimal value of measurement time register. If the
+    result is underrange, it measures again in double high resolution mode
+    with maximal value of measurement time register.
+    - The method keeps one time or continuous kind of current mode.
+    - If the safer setting is the current one already, the method does
+      nothing.
+    - Original configuration is restored after the repeated measurement, so
+      that following measurements use it. The light getters provide the
+      repeated result regardless of it.
+    - At persistent bad quality each automatic redo costs one more
+      conversion and switching the configuration there and back.
+    - The method is called by measureLight() automatically, if it has been
+      enabled by setQualityRedo().
 
     PARAMETERS: none
 
     RETURN: Result code
   */
-  inline ResultCodes measureLight()
+  ResultCodes measureLightRedo();
+
+  /*
+    Start measurement of ambient light intensity without waiting for result.
+
+    DESCRIPTION:
+    In one time modes the method wakes up the sensor by the measurement
+    instruction. In continuous modes the sensor measures permanently, so that
+    the method does nothing, unless recent configuration of the sensor has
+    failed. Then the method sends the configuration again.
+    - The result should be read by the method measureLightFinish() not
+      sooner than measurement time later, otherwise it waits for the rest of
+      measurement time.
+
+    PARAMETERS: none
+
+    RETURN: Result code
+  */
+  inline ResultCodes measureLightStart()
   {
     switch (getMode())
     {
@@ -170,24 +561,230 @@ public:
       case Modes::MODE_ONETIME_HIGH:
       case Modes::MODE_ONETIME_HIGH2:
         // Wake up the sensor
-        if (isError(setMode(getMode())))
-        {
-          return getLastResult();
-        }
         break;
       default:
+        // Continuous conversions run unless configuration has failed
+        if (!status_.flagMtregLost)
+        {
+          return setLastResult();
+        }
         break;
     }
-    uint8_t data[2];
-    if (isError(busReceive(data, sizeof(data) / sizeof(data[0]))))
+    if (isError(setMode(getMode())))
     {
-      return getLastResult();
+      return markStale();
+    }
+    return getLastResult();
+  }
+
+  /*
+    Finish measurement of ambient light intensity started before.
+
+    DESCRIPTION:
+    The method reads the data register and calculates light intensity as the
+    method measureLight() does.
+
+    PARAMETERS: none
+
+    RETURN: Result code
+  */
+  inline ResultCodes measureLightFinish() { return readLight(); }
+
+#if defined(__cpp_impl_coroutine)
+  // Awaitable measurement started at awaiting
+  struct Measurement
+  {
+    gbj_bh1750 *sensor;
+    ResultCodes result;
+    inline bool await_ready()
+    {
+      result = sensor->measureLightStart();
+      return sensor->isError(result);
+    }
+    // Promise of the awaiting coroutine resumes it after the delay
+    template<typename Promise>
+    inline void await_suspend(std::coroutine_handle<Promise> handle)
+    {
+      handle.promise().sleep(sensor->getMeasurementTimeMicros());
+    }
+    inline ResultCodes await_resume()
+    {
+      return sensor->isError(result) ? result : sensor->measureLightFinish();
+    }
+  };
+
+  /*
+    Measure ambient light intensity in a coroutine.
+
+    DESCRIPTION:
+    The method returns an awaitable object, which starts the measurement
+    as measureLightStart() does at awaiting, suspends the coroutine for
+    measurement time, and reads the result as measureLightFinish() does at
+    resuming. Meanwhile an executor runs other coroutines, so that
+    conversions of multiple sensors overlap.
+    - The method is available with C++20 coroutines only.
+    - The awaiting coroutine should be a task of gbj_bh1750_executor or any
+      coroutine, whose promise provides the method sleep(microseconds).
+
+    PARAMETERS: none
+
+    RETURN: Awaitable object providing result code
+  */
+  inline Measurement measure()
+  {
+    return Measurement{ this, ResultCodes::SUCCESS };
+  }
+#endif
+
+  /*
+    Measure ambient light intensity by multiple sensors at once.
+
+    DESCRIPTION:
+    The method starts measurements of all sensors at first and then reads
+    their results in the same order, so that their conversions overlap and
+    the whole readout takes about the longest measurement time.
+    - Values are written directly into arrays of the readout structure at
+      the index of a sensor, so that they can be passed to an encoder or
+      a transmission buffer without copying. Arrays with NULL pointer are
+      skipped.
+    - A sensor with failed measurement provides its recent result marked as
+      stale in the quality flags. Its own result code is available by its
+      method getLastResult().
+    - Automatic redo of a measurement, if enabled by setQualityRedo(), is
+      done for particular sensor right after reading its result.
+
+    PARAMETERS:
+    sensors - Array of pointers to initialized sensor objects.
+      - Data type: pointer to gbj_bh1750 pointers
+      - Default value: none
+      - Limited range: none
+
+    count - Number of sensors.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range: 0 ~ 255
+
+    readout - Structure with pointers to arrays of at least count elements.
+      - Data type: Readout
+      - Default value: none
+      - Limited range: none
+
+    RETURN: Number of successful measurements
+  */
+  static uint8_t measureLightAll(gbj_bh1750 *const sensors[],
+                                 uint8_t count,
+                                 const Readout &readout);
+
+  /*
+    Measure ambient light intensity in extended dynamic range.
+
+    DESCRIPTION:
+    The method measures at first with short exposure in high resolution mode
+    and minimal value of measurement time register. Only if the result is low
+    enough not to saturate, it measures again with long exposure in double
+    high resolution mode and maximal value of measurement time register.
+    - Both exposures are merged as the sum of their counts at the sum of
+      their sensitivities, so that each of them is weighted by its length.
+      If the long exposure saturates, just the short one is used.
+    - The method keeps one time or continuous kind of current mode.
+    - Original configuration is restored after measuring, so that following
+      measurements use it. The light getters provide the merged light
+      intensity regardless of it.
+    - Exposures are not filtered and observers are notified just about the
+      merged result.
+
+    PARAMETERS: none
+
+    RETURN: Result code
+  */
+  ResultCodes measureLightHdr();
+
+  /*
+    Calibrate conversion time of the sensor.
+
+    DESCRIPTION:
+    The method measures how soon the data register of the particular sensor
+    actually updates after a measurement instruction and uses that time
+    instead of datasheet values for waiting on measurement results.
+    - The method clears the data register and starts continuous measurement
+      of current resolution. Then it polls the data register until it
+      changes.
+    - The measured time is stored as a percentage of the datasheet typical
+      conversion time, so that it is valid for other modes and resolutions.
+    - The ambient light should not be darkness, otherwise the data register
+      does not change and the calibration fails.
+    - The calibration fails as well, if the data register changes sooner
+      than in the half of the typical conversion time, e.g., if it has not
+      been cleared, because such a timing would read stale results.
+    - If the current mode is one time, the sensor is put to power down
+      afterwards.
+    - The calibration is cancelled by setTimingTyp() or setTimingMax().
+
+    PARAMETERS:
+    margin - Safety margin in percent added to the measured conversion time.
+      - Data type: non-negative integer
+      - Default value: 5
+      - Limited range: 0 ~ 255
+
+    RETURN: Result code
+  */
+  ResultCodes calibrateTiming(uint8_t margin = Timing::TIMING_SAFETY_PERC);
+
+  /*
+    Select the fastest reliable bus clock.
+
+    DESCRIPTION:
+    The method verifies operation of the sensor at 400 kHz bus clock and
+    falls back to 100 kHz, if it is not reliable. The chosen clock stays set
+    and is available by getBusClock().
+    - A verification cycle writes current value of the measurement time
+      register and reads the data register twice. The cycle fails at a bus
+      error or if the data register values differ.
+    - A clock is reliable, if at most one of the cycles fails, which
+      tolerates a conversion finishing between readings.
+    - The configuration of the sensor is not changed and no measurement is
+      started. Errors during verification are not notified to observers.
+    - Other devices on the bus should support the chosen clock as well.
+    - The Linux transport cannot set the bus clock, which is determined by
+      the kernel adapter driver, so that the method fails without any
+      verification.
+
+    PARAMETERS:
+    cycles - Number of verification cycles for each clock.
+      - Data type: non-negative integer
+      - Default value: 16
+      - Limited range: 2 ~ 255
+
+    RETURN: Result code of the verification at the chosen clock or
+      ERROR_UNSUPPORTED on the Linux transport
+  */
+  ResultCodes tuneBusClock(uint8_t cycles = BusTuning::BUS_TUNE_CYCLES);
+
+  /*
+    Measure ambient light intensity in milli-lux at typical accuracy.
+
+    DESCRIPTION:
+    The method is an integer alternative to the method measureLightTyp(). If
+    measurement fails, the output argument is not changed.
+
+    PARAMETERS:
+    milliLux - Variable for light intensity in milli-lux.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range: 0 ~ 152 * 10^6
+
+    RETURN: Result code
+  */
+  inline ResultCodes measureLightMilliLux(uint32_t &milliLux)
+  {
+    if (isSuccess(measureLight()))
+    {
+      milliLux = getLightMilliLuxTyp();
     }
-    light_.result = (data[0] << 8) | data[1];
-    calculateLight();
     return getLastResult();
   }
 
+#if !defined(GBJ_BH1750_NOFLOAT)
   /*
     Measure and return ambient light intensity in lux at particular accuracy.
 
@@ -210,12 +807,23 @@ public:
   {
     return isSuccess(measureLight()) ? getLightMin() : 0.0;
   }
+#endif
 
   // Setters
   ResultCodes setAddress(Addresses address);
   ResultCodes setMode(Modes mode);
-  inline void setTimingTyp() { status_.flagMaxMeasurementTime = false; }
-  inline void setTimingMax() { status_.flagMaxMeasurementTime = true; }
+  inline void setTimingTyp()
+  {
+    status_.flagMaxMeasurementTime = false;
+    status_.timingCal = 0;
+    storeDerived();
+  }
+  inline void setTimingMax()
+  {
+    status_.flagMaxMeasurementTime = true;
+    status_.timingCal = 0;
+    storeDerived();
+  }
   inline ResultCodes setResolutionMin()
   {
     return setResolutionVal(MeasurementTiming::MTREG_MIN);
@@ -228,16 +836,172 @@ public:
   {
     return setResolutionVal(MeasurementTiming::MTREG_MAX);
   }
+#if defined(GBJ_BH1750_FILTER)
+  /*
+    Select digital filter of measured values.
+
+    DESCRIPTION:
+    The filter processes the data register value right after reading in
+    integer arithmetic, so that all light getters provide filtered values.
+    - Quality flags are evaluated from the data register value before
+      filtering and a saturated value bypasses the filter.
+    - The filter state is cleared at change of the mode or measurement time
+      register, because the counts change their scale, and at calibration.
+    - Only filters compiled in by their build flags are available.
+
+    PARAMETERS:
+    filter - Type of the filter.
+      - Data type: Filters
+      - Default value: none
+      - Limited range: FILTER_NONE ~ FILTER_KALMAN
+
+    param - Parameter of the filter.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range:
+        FILTER_EMA: 1 ~ 7 as binary logarithm of smoothing samples
+        FILTER_MEDIAN: 1 ~ 7 as number of samples in the window
+        FILTER_KALMAN: 1 ~ 255 as ratio of measurement to process noise
+
+    RETURN: Flag about available filter, otherwise no filter is set
+  */
+  bool setFilter(Filters filter, uint8_t param);
+  inline void resetFilter() { filter_.count = 0; }
+
+#endif
+  // Repeat measurement with bad quality automatically at a safer setting
+  inline void setQualityRedo(bool redo = true)
+  {
+    status_.flagQualityRedo = redo;
+  }
 
   // Getters
+  inline bool getTimingTyp()
+  {
+    return !status_.flagMaxMeasurementTime && !status_.timingCal;
+  }
+  inline bool getTimingMax()
+  {
+    return status_.flagMaxMeasurementTime && !status_.timingCal;
+  }
+  // Calibrated conversion time in percent of typical one, zero if none
+  inline uint8_t getTimingCal() { return status_.timingCal; }
+  // Recent value of data register
+  inline uint16_t getLightResult() { return light_.result; }
+  // Recent value of data register before filtering
+  inline uint16_t getLightRaw()
+  {
+#if defined(GBJ_BH1750_FILTER)
+    return filter_.raw;
+#else
+    return light_.result;
+#endif
+  }
+  inline bool getQualityRedo() { return status_.flagQualityRedo; }
+#if defined(GBJ_BH1750_FILTER)
+  inline Filters getFilter() { return filter_.type; }
+  inline uint8_t getFilterParam() { return filter_.param; }
+#endif
+  // Quality flags of the recent result
+  inline uint8_t getQuality() { return status_.quality; }
+  inline bool isQualityOk() { return getQuality() == Quality::QUALITY_OK; }
+  // Recent light in milli-lux at particular accuracy
+  inline uint32_t getLightMilliLuxMin()
+  {
+    return calculateMilliLux(light_.result, light_.senseNum, ACCURACY_MAX);
+  }
+  inline uint32_t getLightMilliLuxTyp()
+  {
+    return calculateMilliLux(light_.result, light_.senseNum, ACCURACY_TYP);
+  }
+  inline uint32_t getLightMilliLuxMax()
+  {
+    return calculateMilliLux(light_.result, light_.senseNum, ACCURACY_MIN);
+  }
+  // milli-lux/bitCount
+  inline uint32_t getSensitivityMilliMin()
+  {
+    return calculateMilliLux(1, calculateSenseNum(), ACCURACY_MAX);
+  }
+  inline uint32_t getSensitivityMilliTyp()
+  {
+    return calculateMilliLux(1, calculateSenseNum(), ACCURACY_TYP);
+  }
+  inline uint32_t getSensitivityMilliMax()
+  {
+    return calculateMilliLux(1, calculateSenseNum(), ACCURACY_MIN);
+  }
+  // bitCount/kilo-lux
+  inline uint32_t getResolutionMilliMin()
+  {
+    return calculateResolution(ACCURACY_MAX);
+  }
+  inline uint32_t getResolutionMilliTyp()
+  {
+    return calculateResolution(ACCURACY_TYP);
+  }
+  inline uint32_t getResolutionMilliMax()
+  {
+    return calculateResolution(ACCURACY_MIN);
+  }
+  // Smallest distinguishable change of recent light in milli-lux at typical
+  // accuracy and at the sensitivity the result is measured at
+  inline uint32_t getLightResolutionMilli()
+  {
+    return calculateMilliLux(getLightStep(), light_.senseNum, ACCURACY_TYP);
+  }
+#if !defined(GBJ_BH1750_NOFLOAT)
+  // Smallest distinguishable change of recent light in lux at typical
+  // accuracy and at the sensitivity the result is measured at
+  inline float getLightResolution()
+  {
+    return calculateLux(getLightStep(), ACCURACY_TYP);
+  }
+#endif
+  // Measurement time used for waiting on a result rounded up to milliseconds
+  inline uint16_t getMeasurementTime()
+  {
+    return (getMeasurementTimeMicros() + 999) / 1000;
+  }
+#if defined(GBJ_BH1750_LEAN)
+  inline Modes getMode()
+  {
+    return static_cast<Modes>((status_.modeOnetime ? 0x20 : 0x10) |
+                              status_.modeBits);
+  }
+  inline uint32_t getMeasurementTimeMicros()
+  {
+    return calculateMeasurementTime();
+  }
+  inline uint16_t getMeasurementTimeTyp()
+  {
+    return calculateMeasurementTimeTyp();
+  }
+  inline uint16_t getMeasurementTimeMax()
+  {
+    return calculateMeasurementTimeMax();
+  }
+  #if !defined(GBJ_BH1750_NOFLOAT)
+  inline float getLightMin()
+  {
+    return calculateLux(light_.result, ACCURACY_MAX);
+  }
+  inline float getLightTyp()
+  {
+    return calculateLux(light_.result, ACCURACY_TYP);
+  }
+  inline float getLightMax()
+  {
+    return calculateLux(light_.result, ACCURACY_MIN);
+  }
+  inline float getSenseCoef() { return calculateSenseCoef(); }
+  #endif
+#else
   inline Modes getMode() { return status_.mode; }
-  inline bool getTimingTyp() { return !status_.flagMaxMeasurementTime; }
-  inline bool getTimingMax() { return status_.flagMaxMeasurementTime; }
-  inline uint16_t getMeasurementTime() { return status_.measurementTime; }
+  inline uint32_t getMeasurementTimeMicros() { return status_.conversionTime; }
   inline uint16_t getMeasurementTimeTyp() { return status_.measurementTimeTyp; }
   inline uint16_t getMeasurementTimeMax() { return status_.measurementTimeMax; }
-  // Recent value of data register
-  inline uint16_t getLightResult() { return light_.result; }
+  #if !defined(GBJ_BH1750_NOFLOAT)
   // Recently measured light at minimal accuracy, so at maximal sensitivity
   inline float getLightMin() { return light_.minimal; }
   // Recently measured light at typical accuracy, so at maximal sensitivity
@@ -246,6 +1010,9 @@ public:
   inline float getLightMax() { return light_.maximal; }
   // Recently set sensitivity coefficient (lux/bitCount)
   inline float getSenseCoef() { return status_.senseCoef; }
+  #endif
+#endif
+#if !defined(GBJ_BH1750_NOFLOAT)
   // lux/bitCount
   inline float getSensitivityMin()
   {
@@ -276,6 +1043,7 @@ public:
   inline float getResolutionMin() { return 1.0 / getSensitivityMin(); }
   inline float getResolutionTyp() { return 1.0 / getSensitivityTyp(); }
   inline float getResolutionMax() { return 1.0 / getSensitivityMax(); }
+#endif
 
 private:
   enum Commands : uint8_t
@@ -298,7 +1066,47 @@ private:
     TIMING_LOWRESMODE_MAX = 24,
     // Safety percentage increase of a final conversion time
     TIMING_SAFETY_PERC = 5,
+    // Polling period of data register at calibration in microseconds
+    TIMING_CAL_STEP = 250,
+    // Shortest plausible calibrated conversion time in percent of typical one
+    TIMING_CAL_MIN = 50,
+  };
+  enum BusTuning : uint8_t
+  {
+    BUS_TUNE_CYCLES = 16, // Default verification cycles per clock
+    BUS_TUNE_FAILS = 1, // Tolerated failed verification cycles
+  };
+  enum Counts : uint16_t
+  {
+    COUNT_MAX = 0xFFFF, // Saturated data register
+    COUNT_HDR = 58982, // Limit of long exposure data register at 90% of range
+    COUNT_UNDER = 10, // Result steps for quantization error up to 10%
   };
+#if defined(GBJ_BH1750_FILTER)
+  enum FilterParams : uint8_t
+  {
+    FILTER_EMA_MAX = 7, // Maximal smoothing shift
+    FILTER_MEDIAN_MAX = 7, // Maximal median window
+    FILTER_FRACTION = 8, // Fraction bits of estimates
+  };
+  struct Filter
+  {
+    Filters type;
+    uint8_t param;
+    uint8_t count; // Samples in the state since reset
+    uint16_t raw; // Recent data register value before filtering
+  #if defined(GBJ_BH1750_FILTER_EMA) || defined(GBJ_BH1750_FILTER_KALMAN)
+    uint32_t estimate; // Filtered counts with fraction bits
+  #endif
+  #if defined(GBJ_BH1750_FILTER_KALMAN)
+    uint32_t variance; // Estimate variance in process noise with fraction
+  #endif
+  #if defined(GBJ_BH1750_FILTER_MEDIAN)
+    uint16_t window[FilterParams::FILTER_MEDIAN_MAX]; // Circular buffer
+  #endif
+  } filter_;
+  uint16_t filterSample(uint16_t result);
+#endif
   enum MeasurementTiming : uint8_t
   {
     MTREG_TYP = 69, // Typical value of measurement time register
@@ -313,47 +1121,273 @@ private:
     ACCURACY_MAX = 144, // Maximal measurement accuracy 1.44 count/lux
   };
   // Initially set to default values
+#if defined(GBJ_BH1750_LEAN)
+  // Mode and flags packed into two bytes
+  struct Status
+  {
+    MeasurementTiming mtreg; // Current value of measurement time register
+    uint8_t modeBits : 2; // Lowest bits of the mode instruction
+    uint8_t modeOnetime : 1; // One time mode instruction flag
+    uint8_t flagMaxMeasurementTime : 1;
+    uint8_t quality : 4; // Quality flags of the recent result
+    uint8_t flagQualityRedo : 1;
+    uint8_t flagMtregLost : 1; // Sensor register may differ from mtreg
+    uint8_t flagResultLow : 1; // Recent result in steps of low resolution
+    uint8_t timingCal; // Calibrated percentage of typical conversion time
+  } status_;
+  struct Light
+  {
+    uint16_t result; // Sensor output of measurement
+    uint16_t senseNum; // Sensitivity numerator the result is measured at
+  } light_;
+  inline void storeMode(Modes mode)
+  {
+    status_.modeBits = mode & 0x03;
+    status_.modeOnetime = (mode & 0x20) ? 1 : 0;
+  }
+  inline void calculateLight() {}
+#else
   struct Status
   {
     Modes mode; // Current measurement mode of the sensor
     MeasurementTiming mtreg; // Current value of measurement time register
+    bool flagMtregLost; // Sensor register may differ from mtreg
+    bool flagResultLow; // Recent result in steps of low resolution
+  #if !defined(GBJ_BH1750_NOFLOAT)
     float senseCoef; // Sensitivity coeficient
+  #endif
     bool flagMaxMeasurementTime;
-    uint16_t measurementTime; // In milliseconds
+    bool flagQualityRedo;
+    uint8_t quality; // Quality flags of the recent result
+    uint8_t timingCal; // Calibrated percentage of typical conversion time
+    uint32_t conversionTime; // In microseconds including safety margin
     uint16_t measurementTimeTyp; // In milliseconds
     uint16_t measurementTimeMax; // In milliseconds
   } status_;
   struct Light
   {
     uint16_t result; // Sensor output of measurement
+    uint16_t senseNum; // Sensitivity numerator the result is measured at
+  #if !defined(GBJ_BH1750_NOFLOAT)
     float typical; // Light intensity in lux at typical measurement accuracy
     float minimal; // Light intensity in lux at minimal measurement accuracy
     float maximal; // Light intensity in lux at maximal measurement accuracy
+  #endif
   } light_;
+  inline void storeMode(Modes mode) { status_.mode = mode; }
   inline void calculateLight()
   {
-    light_.typical = static_cast<float>(light_.result) * getSensitivityTyp();
-    light_.minimal = static_cast<float>(light_.result) * getSensitivityMin();
-    light_.maximal = static_cast<float>(light_.result) * getSensitivityMax();
+  #if !defined(GBJ_BH1750_NOFLOAT)
+    light_.typical = calculateLux(light_.result, ACCURACY_TYP);
+    light_.minimal = calculateLux(light_.result, ACCURACY_MAX);
+    light_.maximal = calculateLux(light_.result, ACCURACY_MIN);
+  #endif
+  }
+#endif
+  // Read data register value without filtering and without notifying
+  inline ResultCodes readCounts(uint16_t &counts)
+  {
+    uint8_t data[2];
+    if (isError(busReceive(data, sizeof(data) / sizeof(data[0]))))
+    {
+      markStale();
+      return notifyError();
+    }
+    counts = (data[0] << 8) | data[1];
+    return getLastResult();
+  }
+  // Saturation and underrange flags of a data register value
+  inline uint8_t calculateRange(uint16_t counts)
+  {
+    uint8_t quality = Quality::QUALITY_OK;
+    if (counts > Counts::COUNT_MAX - getResultStep())
+    {
+      quality |= Quality::QUALITY_SATURATED;
+    }
+    if (counts < Counts::COUNT_UNDER * getResultStep())
+    {
+      quality |= Quality::QUALITY_UNDERRANGE;
+    }
+    return quality;
+  }
+  // Take over a result measured at a sensitivity numerator with its range
+  inline void storeSample(uint16_t result, uint16_t senseNum, uint8_t range)
+  {
+    light_.result = result;
+    light_.senseNum = senseNum;
+    // Sample is stored at the profile it has been measured at
+    status_.flagResultLow = getResultStep() > 1;
+    status_.quality = (status_.quality & Quality::QUALITY_STALE)
+                        ? Quality::QUALITY_AFTER_ERROR
+                        : Quality::QUALITY_OK;
+    status_.quality |= range;
+    calculateLight();
+  }
+  // Read data register without waking up the sensor and without notifying
+  inline ResultCodes readData()
+  {
+    uint16_t counts = 0;
+    if (isError(readCounts(counts)))
+    {
+      return getLastResult();
+    }
+    // Range is judged by the sensor output itself
+    uint8_t range = calculateRange(counts);
+#if defined(GBJ_BH1750_FILTER)
+    filter_.raw = counts;
+    // Saturated value is not a measurement and would distort the state
+    if (!(range & Quality::QUALITY_SATURATED))
+    {
+      counts = filterSample(counts);
+    }
+#endif
+    storeSample(counts, calculateSenseNum(), range);
+    // Next reading waits for next conversion in continuous mode
+    startConversion();
+    return getLastResult();
+  }
+  // Measure data register value at a profile without notifying
+  ResultCodes measureCounts(const Profile &profile, uint16_t &counts);
+  inline ResultCodes readLight()
+  {
+    waitConversion();
+    if (isSuccess(readData()))
+    {
+      notify(Events::EVENT_MEASURE);
+    }
+    return getLastResult();
+  }
+  void notify(Events event);
+  inline ResultCodes notifyError()
+  {
+    notify(Events::EVENT_ERROR);
+    return getLastResult();
+  }
+  // Keep the result, but mark it as not being the recent one
+  inline ResultCodes markStale()
+  {
+    status_.quality |= Quality::QUALITY_STALE;
+    return getLastResult();
+  }
+  // Data register counts per result step, low resolution ignores 2 bits
+  inline uint8_t getResultStep()
+  {
+    return (getMode() & 0x03) == 0x03 ? 4 : 1;
+  }
+  // Data register step of the recent result
+  inline uint8_t getLightStep() { return status_.flagResultLow ? 4 : 1; }
+  // Sensitivity coefficient multiplied by typical measurement time register
+  inline uint16_t calculateSenseNum()
+  {
+    switch (getMode())
+    {
+      case Modes::MODE_CONTINUOUS_HIGH2:
+      case Modes::MODE_ONETIME_HIGH2:
+        return 2 * status_.mtreg;
+      default:
+        return status_.mtreg;
+    }
+  }
+  // Quotient multiplied by power of 10 without overflow and with rounding
+  static uint32_t divDecimal(uint32_t num, uint32_t den, uint8_t digits);
+  // Light in milli-lux for data register value at sensitivity numerator and
+  // accuracy in count/lux * 100
+  inline uint32_t calculateMilliLux(uint16_t result,
+                                    uint16_t senseNum,
+                                    uint8_t accuracy)
+  {
+    return divDecimal(static_cast<uint32_t>(result) * MTREG_TYP,
+                      static_cast<uint32_t>(accuracy) * senseNum,
+                      5);
+  }
+  // bitCount per kilo-lux at accuracy in count/lux * 100
+  inline uint32_t calculateResolution(uint8_t accuracy)
+  {
+    return divDecimal(static_cast<uint32_t>(accuracy) * calculateSenseNum(),
+                      MTREG_TYP,
+                      1);
+  }
+#if !defined(GBJ_BH1750_NOFLOAT)
+  // Light in lux for data register value at sensitivity numerator of the
+  // recent result and accuracy in count/lux * 100
+  inline float calculateLux(uint16_t result, uint8_t accuracy)
+  {
+    return static_cast<float>(result) * 100.0 *
+           static_cast<float>(MTREG_TYP) /
+           (static_cast<float>(light_.senseNum) * static_cast<float>(accuracy));
   }
   // Counts per lux
   inline float calculateSenseCoef()
   {
-    status_.senseCoef = static_cast<float>(status_.mtreg) /
-                        static_cast<float>(MeasurementTiming::MTREG_TYP);
+    float senseCoef = static_cast<float>(status_.mtreg) /
+                      static_cast<float>(MeasurementTiming::MTREG_TYP);
     switch (getMode())
     {
       case Modes::MODE_CONTINUOUS_HIGH2:
       case Modes::MODE_ONETIME_HIGH2:
-        status_.senseCoef *= 2.0;
+        senseCoef *= 2.0;
         break;
       default:
         break;
     }
-    return status_.senseCoef;
+#if !defined(GBJ_BH1750_LEAN)
+    status_.senseCoef = senseCoef;
+#endif
+    return senseCoef;
+  }
+#endif
+  // Datasheet conversion time in milliseconds for current mode
+  uint8_t getTimingDefault(bool flagMax);
+  // Conversion time in microseconds scaled by measurement time register
+  inline uint32_t calculateConversionTime(bool flagMax)
+  {
+    return (static_cast<uint32_t>(status_.mtreg) * getTimingDefault(flagMax) *
+              1000UL +
+            MTREG_TYP - 1) /
+           MTREG_TYP;
+  }
+  inline uint16_t calculateMeasurementTimeTyp()
+  {
+    return (calculateConversionTime(false) + 999) / 1000;
+  }
+  inline uint16_t calculateMeasurementTimeMax()
+  {
+    return (calculateConversionTime(true) + 999) / 1000;
+  }
+  // Conversion time in microseconds used for measurement with safety margin
+  uint32_t calculateMeasurementTime();
+  // Store values derived from current configuration
+  inline void storeDerived()
+  {
+#if !defined(GBJ_BH1750_LEAN)
+  #if !defined(GBJ_BH1750_NOFLOAT)
+    calculateSenseCoef();
+  #endif
+    status_.measurementTimeTyp = calculateMeasurementTimeTyp();
+    status_.measurementTimeMax = calculateMeasurementTimeMax();
+    status_.conversionTime = calculateMeasurementTime();
+#endif
   }
-  void setMeasurementTime();
-  ResultCodes setResolutionVal(MeasurementTiming mtreg);
+  // Start of the recent conversion in microseconds
+  uint32_t timestampConversion_;
+  inline void startConversion() { timestampConversion_ = micros(); }
+  // Wait for the rest of conversion time since its start
+  void waitConversion();
+  static Modes sanitizeMode(Modes mode);
+  static MeasurementTiming sanitizeMtreg(Modes mode, uint8_t mtreg);
+  // Send measurement time register and measurement instruction as needed
+  ResultCodes sendConfig(Modes mode,
+                         MeasurementTiming mtreg,
+                         bool flagMtreg,
+                         bool flagMode);
+  // Count failed bus verification cycles up to the tolerated number plus one
+  uint8_t verifyBus(uint8_t cycles);
+  // Take over profile without communication with the sensor
+  void storeProfile(const Profile &profile);
+  static uint8_t crc8(const uint8_t *data, uint8_t len);
+  Observer *observers_;
+  ResultCodes setResolutionVal(MeasurementTiming mtreg,
+                               bool modeChanged = false);
 };
 
 #endif
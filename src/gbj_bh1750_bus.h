@@ -0,0 +1,66 @@
+/*
+  NAME:
+  gbj_bh1750_bus
+
+  DESCRIPTION:
+  Compile-time selection of the bus transport the sensor library is built on.
+  - The transport is a base class of the sensor class, so that it is resolved
+    statically without any virtual dispatch.
+  - By default the Arduino two-wire library gbj_twowire is used.
+  - Build flag GBJ_BH1750_TRANSPORT_LINUX selects Linux i2c-dev transport.
+  - Build flag GBJ_BH1750_TRANSPORT_SIM selects in-memory sensor simulator.
+  - Every transport provides the same result codes, clock speeds, and bus
+    methods as gbj_twowire does, and the method busProbe() for address only
+    transaction, which the two-wire library lacks and it is added to it
+    by a thin derived class.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_BUS_H
+#define GBJ_BH1750_BUS_H
+
+#if defined(GBJ_BH1750_TRANSPORT_LINUX)
+  #include "gbj_bh1750_linux.h"
+typedef gbj_bh1750_linux gbj_bh1750_bus;
+#elif defined(GBJ_BH1750_TRANSPORT_SIM)
+  #include "gbj_bh1750_sim.h"
+typedef gbj_bh1750_sim gbj_bh1750_bus;
+#else
+  #include "gbj_twowire.h"
+  #include <Wire.h>
+
+class gbj_bh1750_bus : public gbj_twowire
+{
+public:
+  gbj_bh1750_bus(ClockSpeeds clockSpeed = ClockSpeeds::CLOCK_100KHZ,
+                 uint8_t pinSDA = 4,
+                 uint8_t pinSCL = 5)
+    : gbj_twowire(clockSpeed, pinSDA, pinSCL)
+  {
+  }
+
+protected:
+  // Address only transaction without any data
+  inline ResultCodes busProbe(uint8_t address)
+  {
+    Wire.beginTransmission(address);
+    switch (Wire.endTransmission())
+    {
+      case 0:
+        return setLastResult();
+      case 2:
+        return setLastResult(ResultCodes::ERROR_NACK_ADDR);
+      default:
+        return setLastResult(ResultCodes::ERROR_NACK_OTHER);
+    }
+  }
+};
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#include "gbj_bh1750_executor.h"
+#if defined(__cpp_impl_coroutine)
+
+gbj_bh1750_executor::~gbj_bh1750_executor()
+{
+  for (uint8_t i = 0; i < capacity_; i++)
+  {
+    if (slots_[i].handle)
+    {
+      slots_[i].handle.destroy();
+      slots_[i].handle = nullptr;
+    }
+  }
+}
+
+bool gbj_bh1750_executor::spawn(Task task)
+{
+  for (uint8_t i = 0; i < capacity_; i++)
+  {
+    if (!slots_[i].handle)
+    {
+      Task::promise_type &promise = task.handle_.promise();
+      promise.executor = this;
+      promise.slot = i;
+      slots_[i].handle = task.handle_;
+      slots_[i].wakeAt = micros();
+      task.handle_ = nullptr;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint8_t gbj_bh1750_executor::run()
+{
+  uint8_t tasks = 0;
+  for (uint8_t i = 0; i < capacity_; i++)
+  {
+    Slot &slot = slots_[i];
+    if (!slot.handle)
+    {
+      continue;
+    }
+    if (static_cast<int32_t>(micros() - slot.wakeAt) >= 0)
+    {
+      slot.handle.resume();
+    }
+    if (slot.handle.done())
+    {
+      slot.handle.destroy();
+      slot.handle = nullptr;
+      continue;
+    }
+    tasks++;
+  }
+  return tasks;
+}
+
+void gbj_bh1750_executor::runAll()
+{
+  while (run())
+  {
+    uint32_t idle = idleTime();
+    if (idle)
+    {
+      delayMicroseconds(idle);
+    }
+  }
+}
+
+void gbj_bh1750_executor::schedule(uint8_t slot, uint32_t us)
+{
+  slots_[slot].wakeAt = micros() + us;
+}
+
+uint32_t gbj_bh1750_executor::idleTime()
+{
+  uint32_t now = micros();
+  int32_t idle = INT32_MAX;
+  for (uint8_t i = 0; i < capacity_; i++)
+  {
+    if (slots_[i].handle)
+    {
+      idle = min(idle, static_cast<int32_t>(slots_[i].wakeAt - now));
+    }
+  }
+  return max(idle, static_cast<int32_t>(0));
+}
+
+#endif
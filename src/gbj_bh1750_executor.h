@@ -0,0 +1,171 @@
+/*
+  NAME:
+  gbj_bh1750_executor
+
+  DESCRIPTION:
+  Cooperative executor of C++20 coroutines awaiting measurements by sensors.
+  - A coroutine of type gbj_bh1750_executor::Task awaits a measurement by
+    co_await sensor.measure() in straight-line code. It is suspended for
+    conversion time, while the executor resumes other tasks, so that
+    conversions of multiple sensors overlap.
+  - A task can suspend itself for a period by co_await executor.delay().
+  - Tasks are resumed in a single thread in order of their wake up times.
+    Slots of tasks are stored in an array provided by a caller, so that the
+    executor itself does not allocate any memory. Frames of coroutines are
+    allocated by the compiler.
+  - The executor is available on toolchains supporting C++20 coroutines,
+    e.g., host GCC or ESP-IDF, including the simulator transport.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_EXECUTOR_H
+#define GBJ_BH1750_EXECUTOR_H
+
+#include "gbj_bh1750.h"
+
+#if defined(__cpp_impl_coroutine)
+  #include <exception>
+
+class gbj_bh1750_executor
+{
+public:
+  struct Slot
+  {
+    std::coroutine_handle<> handle; // Empty for free slot
+    uint32_t wakeAt; // Time of resuming in microseconds
+  };
+
+  // Return type of coroutines run by the executor
+  class Task
+  {
+  public:
+    struct promise_type
+    {
+      gbj_bh1750_executor *executor;
+      uint8_t slot;
+      inline Task get_return_object()
+      {
+        return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+      // A task starts at its first run of the executor
+      inline std::suspend_always initial_suspend() noexcept { return {}; }
+      // The executor releases the frame of a finished task
+      inline std::suspend_always final_suspend() noexcept { return {}; }
+      inline void return_void() {}
+      // An exception escaping a task cannot be reported by the executor
+      inline void unhandled_exception() { std::terminate(); }
+      // Called by awaitables for suspending the task
+      inline void sleep(uint32_t us) { executor->schedule(slot, us); }
+    };
+
+    inline Task(Task &&other) : handle_(other.handle_)
+    {
+      other.handle_ = nullptr;
+    }
+    inline ~Task()
+    {
+      if (handle_)
+      {
+        handle_.destroy();
+      }
+    }
+
+  private:
+    friend class gbj_bh1750_executor;
+    std::coroutine_handle<promise_type> handle_;
+    inline explicit Task(std::coroutine_handle<promise_type> handle)
+      : handle_(handle)
+    {
+    }
+  };
+
+  // Awaitable suspending a task for a period
+  struct Delay
+  {
+    uint32_t us;
+    inline bool await_ready() { return !us; }
+    template<typename Promise>
+    inline void await_suspend(std::coroutine_handle<Promise> handle)
+    {
+      handle.promise().sleep(us);
+    }
+    inline void await_resume() {}
+  };
+
+  gbj_bh1750_executor(Slot *slots, uint8_t capacity)
+  {
+    slots_ = slots;
+    capacity_ = capacity;
+    for (uint8_t i = 0; i < capacity_; i++)
+    {
+      slots_[i].handle = nullptr;
+    }
+  }
+  ~gbj_bh1750_executor();
+
+  /*
+    Take over a task for running.
+
+    DESCRIPTION:
+    The task is resumed at the next run of the executor. If there is no free
+    slot, the task is destroyed without running.
+
+    PARAMETERS:
+    task - Coroutine returning Task.
+      - Data type: Task
+      - Default value: none
+      - Limited range: none
+
+    RETURN: Flag about success, false if there is no room for the task
+  */
+  bool spawn(Task task);
+
+  /*
+    Resume due tasks.
+
+    DESCRIPTION:
+    The method should be called in the loop as often as possible. It does not
+    block, so that other work of the loop is not delayed.
+
+    PARAMETERS: none
+
+    RETURN: Number of unfinished tasks
+  */
+  uint8_t run();
+
+  /*
+    Run tasks until all of them finish.
+
+    DESCRIPTION:
+    Between resuming due tasks the method sleeps until the nearest wake up
+    time, which advances the virtual time of the simulator transport.
+
+    PARAMETERS: none
+
+    RETURN: none
+  */
+  void runAll();
+
+  // Awaitable suspending a task for the period in milliseconds
+  inline Delay delay(uint32_t ms)
+  {
+    return Delay{ static_cast<uint32_t>(1000UL * ms) };
+  }
+
+private:
+  Slot *slots_;
+  uint8_t capacity_;
+  void schedule(uint8_t slot, uint32_t us);
+  // Time to the nearest wake up in microseconds
+  uint32_t idleTime();
+};
+
+#endif
+
+#endif
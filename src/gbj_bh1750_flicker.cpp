@@ -0,0 +1,96 @@
+#if !defined(GBJ_BH1750_NOFLOAT)
+  #include "gbj_bh1750_flicker.h"
+  #include <math.h>
+
+void gbj_bh1750_flicker::reset()
+{
+  count_ = 0;
+  timeFirst_ = 0;
+  result_.percent = result_.index = 0.0;
+  result_.frequency = result_.rate = 0.0;
+  result_.ready = false;
+}
+
+bool gbj_bh1750_flicker::add(uint16_t result, uint32_t timestamp)
+{
+  if (!count_)
+  {
+    timeFirst_ = timestamp;
+  }
+  samples_[count_++] = result;
+  if (count_ < Params::PARAM_SAMPLES)
+  {
+    return false;
+  }
+  analyse(timestamp - timeFirst_);
+  count_ = 0;
+  return true;
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750_flicker::sample(gbj_bh1750 &sensor)
+{
+  if (sensor.isSuccess(sensor.measureLight()))
+  {
+    // Filtering would smooth away the modulation being analysed
+    add(sensor.getLightRaw(), micros());
+  }
+  return sensor.getLastResult();
+}
+
+void gbj_bh1750_flicker::analyse(uint32_t duration)
+{
+  const uint8_t n = Params::PARAM_SAMPLES;
+  uint32_t sum = 0;
+  uint16_t lightMin = 0xFFFF, lightMax = 0;
+  for (uint8_t i = 0; i < n; i++)
+  {
+    sum += samples_[i];
+    lightMin = min(lightMin, samples_[i]);
+    lightMax = max(lightMax, samples_[i]);
+  }
+  result_.ready = true;
+  result_.rate = duration ? 1000000.0 * (n - 1) / duration : 0.0;
+  result_.percent = result_.index = result_.frequency = 0.0;
+  if (!sum)
+  {
+    return;
+  }
+  float mean = static_cast<float>(sum) / n;
+  result_.percent = 100.0 * (lightMax - lightMin) / (lightMax + lightMin);
+  float above = 0.0;
+  for (uint8_t i = 0; i < n; i++)
+  {
+    if (samples_[i] > mean)
+    {
+      above += samples_[i] - mean;
+    }
+  }
+  result_.index = above / sum;
+  if (lightMax == lightMin)
+  {
+    return;
+  }
+  // Goertzel algorithm for all bins without the direct component
+  float powerMax = 0.0;
+  uint8_t binMax = 0;
+  for (uint8_t k = 1; k <= n / 2; k++)
+  {
+    float coef = 2.0 * cos(2.0 * M_PI * k / n);
+    float s1 = 0.0, s2 = 0.0;
+    for (uint8_t i = 0; i < n; i++)
+    {
+      float s0 = samples_[i] - mean + coef * s1 - s2;
+      s2 = s1;
+      s1 = s0;
+    }
+    float power = s1 * s1 + s2 * s2 - coef * s1 * s2;
+    if (power > powerMax)
+    {
+      powerMax = power;
+      binMax = k;
+    }
+  }
+  result_.frequency = result_.rate * binMax / n;
+}
+
+#endif
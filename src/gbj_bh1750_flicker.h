@@ -0,0 +1,124 @@
+/*
+  NAME:
+  gbj_bh1750_flicker
+
+  DESCRIPTION:
+  Streaming analyser of light flicker fed by back-to-back measurements of the
+  sensor BH1750FVI, typically in continuous low resolution mode with
+  conversion period about 16 ms.
+  - The analyser collects raw data register values into a block of fixed
+    size and evaluates it at its completion, so that its memory is constant.
+    Values are taken before digital filtering, which would smooth away the
+    modulation.
+  - It calculates percent flicker (modulation depth), flicker index (ratio of
+    light above average to total light), and dominant frequency by the
+    Goertzel algorithm evaluated for all frequency bins of the block.
+  - The dominant frequency is the apparent one within the half of sampling
+    rate, so that mains flicker above it is aliased and attenuated by
+    integration of the sensor. It is suitable for detecting low frequency
+    flicker and instability of failing lamps.
+  - The analyser uses floating point, so that it is not available with build
+    flag GBJ_BH1750_NOFLOAT.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_FLICKER_H
+#define GBJ_BH1750_FLICKER_H
+
+#include "gbj_bh1750.h"
+
+#if defined(GBJ_BH1750_NOFLOAT)
+  #error "gbj_bh1750_flicker is not available with GBJ_BH1750_NOFLOAT"
+#endif
+
+class gbj_bh1750_flicker
+{
+public:
+  gbj_bh1750_flicker() { reset(); }
+
+  /*
+    Discard collected samples and recent results.
+
+    PARAMETERS: none
+
+    RETURN: none
+  */
+  void reset();
+
+  /*
+    Add a sample to the analysed block.
+
+    DESCRIPTION:
+    The method stores the sample and if the block is complete, it evaluates
+    it and starts a new one.
+
+    PARAMETERS:
+    result - Value of the sensor's data register.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range: 0 ~ 65535
+
+    timestamp - Time of the sample in microseconds.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range: 0 ~ 2^32 - 1
+
+    RETURN: Flag about evaluated block and updated results
+  */
+  bool add(uint16_t result, uint32_t timestamp);
+
+  /*
+    Measure light by the sensor and add its result to the analysed block.
+
+    DESCRIPTION:
+    The method should be called back-to-back, because the sensor waits for
+    its next conversion in continuous mode.
+
+    PARAMETERS:
+    sensor - Sensor object in continuous measurement mode.
+      - Data type: gbj_bh1750
+      - Default value: none
+      - Limited range: none
+
+    RETURN: Result code of the measurement
+  */
+  gbj_bh1750::ResultCodes sample(gbj_bh1750 &sensor);
+
+  // Getters of the recently evaluated block
+  inline bool isReady() { return result_.ready; }
+  inline uint8_t getSamples() { return count_; }
+  // Modulation depth in percent
+  inline float getFlickerPercent() { return result_.percent; }
+  // Ratio of light above average to total light
+  inline float getFlickerIndex() { return result_.index; }
+  // Apparent dominant frequency in Hertz, zero for steady light
+  inline float getFrequency() { return result_.frequency; }
+  // Sampling rate in Hertz
+  inline float getSamplingRate() { return result_.rate; }
+
+private:
+  enum Params : uint8_t
+  {
+    PARAM_SAMPLES = 64, // Samples in a block
+  };
+  uint16_t samples_[Params::PARAM_SAMPLES];
+  uint32_t timeFirst_; // Timestamp of the first sample in a block
+  uint8_t count_; // Samples in current block
+  struct Result
+  {
+    float percent;
+    float index;
+    float frequency;
+    float rate;
+    bool ready;
+  } result_;
+  void analyse(uint32_t duration);
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "gbj_bh1750_health.h"
+
+void gbj_bh1750_health::begin(gbj_bh1750 &sensor,
+                              Handler handler,
+                              void *context)
+{
+  end();
+  sensor_ = &sensor;
+  handler_ = handler;
+  context_ = context;
+  reset();
+  sensor.attach(observer_,
+                observe,
+                this,
+                gbj_bh1750::Events::EVENT_MEASURE |
+                  gbj_bh1750::Events::EVENT_CONFIG |
+                  gbj_bh1750::Events::EVENT_ERROR);
+}
+
+void gbj_bh1750_health::end()
+{
+  if (sensor_)
+  {
+    sensor_->detach(observer_);
+    sensor_ = NULL;
+  }
+}
+
+void gbj_bh1750_health::reset()
+{
+  errors_ = latencies_ = latencyMax_ = 0;
+  samples_ = timings_ = 0;
+  stuckRun_ = result_ = 0;
+  for (uint8_t i = 0; i < Classes::CLASS_COUNT; i++)
+  {
+    counts_[i] = 0;
+  }
+  armed_ = true;
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750_health::measure()
+{
+  gbj_bh1750 &sensor = *sensor_;
+  uint32_t expected = sensor.getMeasurementTimeMicros();
+  uint32_t timeStart = micros();
+  sensor.measureLight();
+  uint32_t latency = micros() - timeStart;
+  if (sensor.isSuccess())
+  {
+    // Redo measures once more at its own setting
+    if (sensor.getQualityRedo())
+    {
+      expected += sensor.getMeasurementTimeMicros();
+    }
+    expected = expected * Params::PARAM_LATENCY / 100 + 1000;
+    record(latencies_, timings_, latency > expected);
+    latencyMax_ = max(latencyMax_, latency);
+  }
+  check();
+  return sensor.getLastResult();
+}
+
+uint8_t gbj_bh1750_health::check()
+{
+  uint8_t score = getScore();
+  if (score >= threshold_)
+  {
+    armed_ = true;
+  }
+  else if (armed_)
+  {
+    armed_ = false;
+    if (handler_)
+    {
+      handler_(*sensor_, score, context_);
+    }
+  }
+  return score;
+}
+
+uint8_t gbj_bh1750_health::getScore()
+{
+  int16_t score = 100 - getErrorRate() - getLatencyRate() / 2;
+  if (isStuck())
+  {
+    score /= 4;
+  }
+  return max(score, static_cast<int16_t>(0));
+}
+
+void gbj_bh1750_health::observe(gbj_bh1750 &sensor,
+                                gbj_bh1750::Events event,
+                                void *context)
+{
+  gbj_bh1750_health &health = *static_cast<gbj_bh1750_health *>(context);
+  switch (event)
+  {
+    case gbj_bh1750::Events::EVENT_MEASURE:
+      record(health.errors_, health.samples_, false);
+      // Darkness and saturation legitimately keep the data register constant
+      if (!sensor.getLightResult() ||
+          (sensor.getQuality() & gbj_bh1750::Quality::QUALITY_SATURATED))
+      {
+        health.stuckRun_ = 0;
+      }
+      else if (health.stuckRun_ && sensor.getLightResult() == health.result_)
+      {
+        if (health.stuckRun_ < 0xFFFF)
+        {
+          health.stuckRun_++;
+        }
+      }
+      else
+      {
+        health.result_ = sensor.getLightResult();
+        health.stuckRun_ = 1;
+      }
+      break;
+
+    case gbj_bh1750::Events::EVENT_CONFIG:
+      // Data register changes its scale
+      health.stuckRun_ = 0;
+      break;
+
+    case gbj_bh1750::Events::EVENT_ERROR:
+    {
+      record(health.errors_, health.samples_, true);
+      uint8_t &count = health.counts_[classify(sensor.getLastResult())];
+      if (count == 0xFF)
+      {
+        for (uint8_t i = 0; i < Classes::CLASS_COUNT; i++)
+        {
+          health.counts_[i] >>= 1;
+        }
+      }
+      count++;
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+gbj_bh1750_health::Classes gbj_bh1750_health::classify(
+  gbj_bh1750::ResultCodes code)
+{
+  switch (code)
+  {
+    case gbj_bh1750::ResultCodes::ERROR_NACK_ADDR:
+      return Classes::CLASS_ADDR;
+    case gbj_bh1750::ResultCodes::ERROR_NACK_DATA:
+      return Classes::CLASS_DATA;
+    case gbj_bh1750::ResultCodes::ERROR_NACK_OTHER:
+#if defined(GBJ_BH1750_TRANSPORT_LINUX) || defined(GBJ_BH1750_TRANSPORT_SIM)
+    case gbj_bh1750::ResultCodes::ERROR_TIMEOUT:
+#endif
+      return Classes::CLASS_BUS;
+    case gbj_bh1750::ResultCodes::ERROR_BUFFER:
+      return Classes::CLASS_BUFFER;
+    case gbj_bh1750::ResultCodes::ERROR_RCV_DATA:
+      return Classes::CLASS_RCV;
+    default:
+      return Classes::CLASS_OTHER;
+  }
+}
+
+uint8_t gbj_bh1750_health::rate(uint32_t history, uint8_t samples)
+{
+  if (!samples)
+  {
+    return 0;
+  }
+  uint8_t flags = 0;
+  for (; history; history >>= 1)
+  {
+    flags += history & 1;
+  }
+  return flags * 100 / samples;
+}
+
+void gbj_bh1750_health::record(uint32_t &history, uint8_t &samples, bool flag)
+{
+  history = (history << 1) | (flag ? 1 : 0);
+  if (samples < Params::PARAM_WINDOW)
+  {
+    samples++;
+  }
+}
@@ -0,0 +1,189 @@
+/*
+  NAME:
+  gbj_bh1750_health
+
+  DESCRIPTION:
+  Health monitor of a sensor detecting its failures before they corrupt
+  measured data, e.g., a wedged sensor repeating the same value or a slow or
+  flaky bus.
+  - The monitor observes measurement and error events of the sensor, so that
+    all measuring methods are covered, and keeps a run of identical data
+    register values and outcomes of recent measurements.
+  - Latency of measurements is evaluated against the expected measurement
+    time for measurements done by the method measure() of the monitor.
+  - Errors are counted by classes of their result codes, i.e., address not
+    acknowledged, instruction not acknowledged, bus transfer failure
+    including timeout, transfer buffer overflow, incomplete data, and other
+    errors. All counters are halved together when any of them would
+    overflow, so that older errors weigh less, but they are not a window.
+  - The health score in percent combines the error rate, latency outliers
+    rate, and stuck value detection. When it drops below a threshold, a
+    recovery handler is called once, e.g., for resetting or powering off the
+    sensor.
+  - Only integer arithmetic is used and the monitor occupies a few tens of
+    bytes.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_HEALTH_H
+#define GBJ_BH1750_HEALTH_H
+
+#include "gbj_bh1750.h"
+
+class gbj_bh1750_health
+{
+public:
+  // Called when the health score drops below the threshold
+  typedef void (*Handler)(gbj_bh1750 &sensor, uint8_t score, void *context);
+
+  gbj_bh1750_health()
+  {
+    sensor_ = NULL;
+    handler_ = NULL;
+    context_ = NULL;
+    threshold_ = Params::PARAM_THRESHOLD;
+    stuckLimit_ = Params::PARAM_STUCK;
+    reset();
+  }
+  ~gbj_bh1750_health() { end(); }
+
+  /*
+    Start monitoring of a sensor.
+
+    DESCRIPTION:
+    The monitor attaches itself as an observer of the sensor and clears its
+    statistics. A monitor watches just one sensor at a time.
+
+    PARAMETERS:
+    sensor - Sensor object to monitor.
+      - Data type: gbj_bh1750
+      - Default value: none
+      - Limited range: none
+
+    handler - Function called at drop of the health score below threshold.
+      It is called outside notification of sensor's events, so that it can
+      reset or reconfigure the sensor.
+      - Data type: Handler
+      - Default value: NULL
+      - Limited range: none
+
+    context - Arbitrary pointer passed to the handler.
+      - Data type: pointer
+      - Default value: NULL
+      - Limited range: none
+
+    RETURN: none
+  */
+  void begin(gbj_bh1750 &sensor, Handler handler = NULL, void *context = NULL);
+
+  // Stop monitoring and detach from the sensor
+  void end();
+
+  // Discard statistics, e.g., after recovery of the sensor
+  void reset();
+
+  /*
+    Measure light by the sensor with evaluation of its latency.
+
+    DESCRIPTION:
+    The method runs measureLight() of the sensor and counts it as a latency
+    outlier, if it takes more than 150% of expected measurement time plus
+    one millisecond. Then it evaluates the health score and calls the
+    recovery handler, if the score dropped below the threshold. The handler
+    is called again only after the score recovers above the threshold.
+
+    PARAMETERS: none
+
+    RETURN: Result code of the measurement
+  */
+  gbj_bh1750::ResultCodes measure();
+
+  /*
+    Evaluate the health score and call the recovery handler if needed.
+
+    DESCRIPTION:
+    The method does what the method measure() does after measuring, so that
+    it should be called after measurements done by other methods.
+
+    PARAMETERS: none
+
+    RETURN: Health score in percent
+  */
+  uint8_t check();
+
+  // Setters
+  inline void setThreshold(uint8_t score) { threshold_ = score; }
+  // Zero limit disables stuck detection, e.g., at stable artificial light
+  inline void setStuckLimit(uint16_t samples) { stuckLimit_ = samples; }
+
+  // Getters
+  // Health score in percent, 100 for a healthy sensor
+  uint8_t getScore();
+  // Percentage of failed measurements in the recent window
+  inline uint8_t getErrorRate() { return rate(errors_, samples_); }
+  // Percentage of latency outliers in the recent window
+  inline uint8_t getLatencyRate() { return rate(latencies_, timings_); }
+  // Count of errors in the class of the result code since reset, halved
+  // whenever a count would overflow
+  inline uint8_t getErrors(gbj_bh1750::ResultCodes code)
+  {
+    return counts_[classify(code)];
+  }
+  // Number of consecutive identical data register values, except zero and
+  // saturated ones
+  inline uint16_t getStuckRun() { return stuckRun_; }
+  inline bool isStuck() { return stuckLimit_ && stuckRun_ >= stuckLimit_; }
+  // Maximal measurement latency in microseconds since reset
+  inline uint32_t getLatencyMax() { return latencyMax_; }
+  inline uint8_t getThreshold() { return threshold_; }
+  inline uint16_t getStuckLimit() { return stuckLimit_; }
+
+private:
+  enum Params : uint8_t
+  {
+    PARAM_WINDOW = 32, // Recent outcomes in history bits
+    PARAM_THRESHOLD = 50, // Default health score threshold in percent
+    PARAM_STUCK = 64, // Default limit of identical values
+    PARAM_LATENCY = 150, // Latency outlier in percent of expected time
+  };
+  enum Classes : uint8_t
+  {
+    CLASS_ADDR, // Sensor does not respond
+    CLASS_DATA, // Sensor rejects an instruction
+    CLASS_BUS, // Bus transfer failures including timeout
+    CLASS_BUFFER, // Transfer does not fit into the bus buffer
+    CLASS_RCV, // Incomplete or missing data
+    CLASS_OTHER,
+    CLASS_COUNT,
+  };
+  gbj_bh1750 *sensor_;
+  gbj_bh1750::Observer observer_;
+  Handler handler_;
+  void *context_;
+  uint32_t errors_; // Bits of recent failed measurements
+  uint32_t latencies_; // Bits of recent latency outliers
+  uint32_t latencyMax_;
+  uint16_t stuckRun_;
+  uint16_t stuckLimit_;
+  uint16_t result_; // Recent data register value
+  uint8_t counts_[Classes::CLASS_COUNT];
+  uint8_t samples_; // Measurements in the window
+  uint8_t timings_; // Timed measurements in the window
+  uint8_t threshold_;
+  bool armed_; // Recovery handler can be called
+  static void observe(gbj_bh1750 &sensor,
+                      gbj_bh1750::Events event,
+                      void *context);
+  static Classes classify(gbj_bh1750::ResultCodes code);
+  static uint8_t rate(uint32_t history, uint8_t samples);
+  // Shift an outcome into a history window
+  static void record(uint32_t &history, uint8_t &samples, bool flag);
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "gbj_bh1750_histogram.h"
+
+void gbj_bh1750_histogram::reset()
+{
+  for (uint8_t i = 0; i < Params::PARAM_BINS; i++)
+  {
+    bins_[i] = 0;
+  }
+  weight_ = samples_ = 0;
+  lightMin_ = 0xFFFFFFFF;
+  lightMax_ = 0;
+}
+
+void gbj_bh1750_histogram::add(uint32_t milliLux)
+{
+  uint8_t bin = binIndex(milliLux / Params::PARAM_UNIT);
+  if (bins_[bin] == 0xFFFF)
+  {
+    halve();
+  }
+  bins_[bin]++;
+  weight_++;
+  samples_++;
+  lightMin_ = min(lightMin_, milliLux);
+  lightMax_ = max(lightMax_, milliLux);
+}
+
+gbj_bh1750::ResultCodes gbj_bh1750_histogram::sample(gbj_bh1750 &sensor)
+{
+  if (sensor.isSuccess(sensor.measureLight()))
+  {
+    add(sensor.getLightMilliLuxTyp());
+  }
+  return sensor.getLastResult();
+}
+
+void gbj_bh1750_histogram::merge(const gbj_bh1750_histogram &other)
+{
+  uint32_t binMax = 0;
+  for (uint8_t i = 0; i < Params::PARAM_BINS; i++)
+  {
+    binMax = max(binMax, static_cast<uint32_t>(bins_[i]) + other.bins_[i]);
+  }
+  uint8_t shift = 0;
+  while ((binMax >> shift) > 0xFFFF)
+  {
+    shift++;
+  }
+  weight_ = 0;
+  for (uint8_t i = 0; i < Params::PARAM_BINS; i++)
+  {
+    bins_[i] = (static_cast<uint32_t>(bins_[i]) + other.bins_[i]) >> shift;
+    weight_ += bins_[i];
+  }
+  samples_ += other.samples_;
+  lightMin_ = min(lightMin_, other.lightMin_);
+  lightMax_ = max(lightMax_, other.lightMax_);
+}
+
+uint32_t gbj_bh1750_histogram::getPercentile(uint8_t percent)
+{
+  if (!weight_)
+  {
+    return 0;
+  }
+  if (!percent)
+  {
+    return lightMin_;
+  }
+  percent = min(percent, static_cast<uint8_t>(100));
+  // Rank of the sample reaching the percentage
+  uint32_t rank = (weight_ * percent + 99) / 100;
+  uint32_t below = 0;
+  uint8_t bin = 0;
+  while (below + bins_[bin] < rank)
+  {
+    below += bins_[bin++];
+  }
+  // Middle of the rank's share of the bin in 1/256 of the bin width
+  uint32_t fraction = ((2 * (rank - below) - 1) << 8) / (2 * bins_[bin]);
+  uint32_t lower = binLower(bin);
+  uint32_t width = binLower(bin + 1) - lower;
+  uint32_t value = (lower + ((width * fraction) >> 8)) * Params::PARAM_UNIT;
+  return constrain(value, lightMin_, lightMax_);
+}
+
+uint8_t gbj_bh1750_histogram::binIndex(uint32_t value)
+{
+  if (value < Params::PARAM_SUBBINS)
+  {
+    return value;
+  }
+  // Position of the leading bit
+  uint8_t msb = Params::PARAM_SUBBITS;
+  while (value >> (msb + 1))
+  {
+    msb++;
+  }
+  uint8_t bin = (msb - 1) * Params::PARAM_SUBBINS +
+                ((value >> (msb - Params::PARAM_SUBBITS)) &
+                 (Params::PARAM_SUBBINS - 1));
+  return min(bin, static_cast<uint8_t>(Params::PARAM_BINS - 1));
+}
+
+uint32_t gbj_bh1750_histogram::binLower(uint8_t bin)
+{
+  if (bin < Params::PARAM_SUBBINS)
+  {
+    return bin;
+  }
+  uint8_t msb = bin / Params::PARAM_SUBBINS + 1;
+  return static_cast<uint32_t>(Params::PARAM_SUBBINS +
+                               bin % Params::PARAM_SUBBINS)
+         << (msb - Params::PARAM_SUBBITS);
+}
+
+void gbj_bh1750_histogram::halve()
+{
+  weight_ = 0;
+  for (uint8_t i = 0; i < Params::PARAM_BINS; i++)
+  {
+    bins_[i] >>= 1;
+    weight_ += bins_[i];
+  }
+}
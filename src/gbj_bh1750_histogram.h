@@ -0,0 +1,139 @@
+/*
+  NAME:
+  gbj_bh1750_histogram
+
+  DESCRIPTION:
+  Fixed memory histogram of light intensity for percentile statistics over
+  time windows, e.g., hourly distribution of daylight.
+  - Samples are normalized by current sensitivity of the sensor to integer
+    milli-lux, so that measurements at various modes and measurement time
+    register values can be mixed in a window.
+  - Bins have logarithmic scale with 4 bins per octave of deci-lux from
+    0.4 lx up to the range of the sensor, which keeps relative width of bins
+    at most 25% in the whole range. Below 0.4 lx the bins are linear.
+  - Adding a sample takes constant time and the histogram occupies fixed
+    memory of a couple hundreds of bytes.
+  - If a bin counter would overflow, all counters are halved, so that
+    percentiles remain valid and older samples just weigh less.
+  - Histograms of consecutive windows can be merged into a histogram of
+    a longer window, e.g., hourly ones into a daily one.
+  - Only integer arithmetic is used.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_HISTOGRAM_H
+#define GBJ_BH1750_HISTOGRAM_H
+
+#include "gbj_bh1750.h"
+
+class gbj_bh1750_histogram
+{
+public:
+  gbj_bh1750_histogram() { reset(); }
+
+  /*
+    Discard all samples.
+
+    PARAMETERS: none
+
+    RETURN: none
+  */
+  void reset();
+
+  /*
+    Add a sample to the histogram.
+
+    PARAMETERS:
+    milliLux - Light intensity in milli-lux.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range: 0 ~ 2^32 - 1, values above range of the sensor are
+        counted in the highest bin
+
+    RETURN: none
+  */
+  void add(uint32_t milliLux);
+
+  /*
+    Measure light by the sensor and add its result to the histogram.
+
+    DESCRIPTION:
+    The sample is added only at successful measurement, so that failed
+    measurements do not repeat an older value.
+
+    PARAMETERS:
+    sensor - Initialized sensor object.
+      - Data type: gbj_bh1750
+      - Default value: none
+      - Limited range: none
+
+    RETURN: Result code of the measurement
+  */
+  gbj_bh1750::ResultCodes sample(gbj_bh1750 &sensor);
+
+  /*
+    Add all samples of another histogram.
+
+    DESCRIPTION:
+    If a merged bin counter would overflow, all counters are scaled down
+    by halving, so that the ratio of both histograms is kept.
+
+    PARAMETERS:
+    other - Histogram of another time window.
+      - Data type: gbj_bh1750_histogram
+      - Default value: none
+      - Limited range: none
+
+    RETURN: none
+  */
+  void merge(const gbj_bh1750_histogram &other);
+
+  /*
+    Estimate percentile of light intensity.
+
+    DESCRIPTION:
+    The value is interpolated linearly within the bin containing the
+    percentile and limited by extreme samples.
+
+    PARAMETERS:
+    percent - Percentage of samples at or below the returned value.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range: 0 ~ 100
+
+    RETURN: Light intensity in milli-lux, zero for empty histogram
+  */
+  uint32_t getPercentile(uint8_t percent);
+
+  // Number of samples added since reset
+  inline uint32_t getSamples() { return samples_; }
+  // Extreme samples in milli-lux
+  inline uint32_t getMin() { return samples_ ? lightMin_ : 0; }
+  inline uint32_t getMax() { return lightMax_; }
+
+private:
+  enum Params : uint8_t
+  {
+    PARAM_SUBBITS = 2, // Bits of a value below its leading bit for a bin
+    PARAM_SUBBINS = 4, // Bins per octave
+    PARAM_OCTAVES = 20, // Octaves of deci-lux covering the sensor's range
+    PARAM_BINS = PARAM_SUBBINS * PARAM_OCTAVES,
+    PARAM_UNIT = 100, // Milli-lux in a deci-lux
+  };
+  uint16_t bins_[Params::PARAM_BINS];
+  uint32_t weight_; // Sum of bin counters
+  uint32_t samples_;
+  uint32_t lightMin_;
+  uint32_t lightMax_;
+  static uint8_t binIndex(uint32_t value);
+  static uint32_t binLower(uint8_t bin);
+  void halve();
+};
+
+#endif
@@ -0,0 +1,32 @@
+#if defined(GBJ_BH1750_TRANSPORT_LINUX) || defined(GBJ_BH1750_TRANSPORT_SIM)
+  #include "gbj_bh1750_host.h"
+
+gbj_bh1750_host::ResultCodes gbj_bh1750_host::registerAddress(uint8_t address)
+{
+  if (address < Addressing::ADDRESS_MIN || address > Addressing::ADDRESS_MAX)
+  {
+    return setLastResult(ResultCodes::ERROR_ADDRESS);
+  }
+  busStatus_.address = address;
+  return setLastResult();
+}
+
+void gbj_bh1750_host::waitSend()
+{
+  uint32_t elapsed = millis() - busStatus_.timestampSend;
+  if (elapsed < busStatus_.delaySend)
+  {
+    delay(busStatus_.delaySend - elapsed);
+  }
+}
+
+void gbj_bh1750_host::waitReceive()
+{
+  uint32_t elapsed = millis() - busStatus_.timestampReceive;
+  if (elapsed < busStatus_.delayReceive)
+  {
+    delay(busStatus_.delayReceive - elapsed);
+  }
+}
+
+#endif
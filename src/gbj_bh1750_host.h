@@ -0,0 +1,155 @@
+/*
+  NAME:
+  gbj_bh1750_host
+
+  DESCRIPTION:
+  Common base of transports for host (non-Arduino) builds of the library.
+  - The class mirrors the part of the gbj_twowire interface the sensor library
+    relies on, i.e., result codes, clock speeds, bus stop flag, delays and
+    timestamps of sending and receiving, and the address registration.
+  - The derived transport provides the methods begin(), release(), busSend(),
+    and busReceive(), which are resolved at compile time.
+  - The header provides replacements of Arduino core timing functions and
+    helper macros used by the library. Their implementation is provided by
+    the selected transport, so that the simulator can run on virtual time.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_HOST_H
+#define GBJ_BH1750_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef ARDUINO
+// Arduino core replacements implemented by the selected host transport
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+template<typename T, typename L, typename H>
+inline T constrain(T amt, L low, H high)
+{
+  return amt < low ? static_cast<T>(low)
+                   : (amt > high ? static_cast<T>(high) : amt);
+}
+template<typename T, typename U>
+inline auto max(T a, U b) -> decltype(a + b)
+{
+  return a > b ? a : b;
+}
+template<typename T, typename U>
+inline auto min(T a, U b) -> decltype(a + b)
+{
+  return a < b ? a : b;
+}
+#endif
+
+class gbj_bh1750_host
+{
+public:
+  enum ResultCodes : uint8_t
+  {
+    SUCCESS = 0,
+    ERROR_BUFFER = 1, // Data too long to fit in transfer buffer
+    ERROR_NACK_ADDR = 2, // Received NACK on transmit of address
+    ERROR_NACK_DATA = 3, // Received NACK on transmit of data
+    ERROR_NACK_OTHER = 4, // Other transfer error
+    ERROR_TIMEOUT = 5, // Bus transfer timed out
+    ERROR_ADDRESS = 255, // Bad address
+    ERROR_PINS = 254, // Bus device cannot be opened
+    ERROR_RCV_DATA = 253, // Less data received than expected
+    ERROR_UNSUPPORTED = 252, // Operation not available on the transport
+  };
+  enum ClockSpeeds : uint32_t
+  {
+    CLOCK_100KHZ = 100000L,
+    CLOCK_400KHZ = 400000L,
+  };
+
+  gbj_bh1750_host(ClockSpeeds clockSpeed = ClockSpeeds::CLOCK_100KHZ,
+                  uint8_t pinSDA = 4,
+                  uint8_t pinSCL = 5)
+  {
+    busStatus_.clock = clockSpeed;
+    busStatus_.pinSDA = pinSDA;
+    busStatus_.pinSCL = pinSCL;
+    busStatus_.address = 0;
+    busStatus_.busStop = true;
+    busStatus_.lastResult = ResultCodes::SUCCESS;
+    busStatus_.delaySend = busStatus_.delayReceive = 0;
+    busStatus_.timestampSend = busStatus_.timestampReceive = 0;
+  }
+
+  // Result handling
+  inline ResultCodes setLastResult(ResultCodes result = ResultCodes::SUCCESS)
+  {
+    return busStatus_.lastResult = result;
+  }
+  inline ResultCodes getLastResult() { return busStatus_.lastResult; }
+  inline bool isSuccess(ResultCodes result)
+  {
+    return result == ResultCodes::SUCCESS;
+  }
+  inline bool isSuccess() { return isSuccess(getLastResult()); }
+  inline bool isError(ResultCodes result) { return !isSuccess(result); }
+  inline bool isError() { return isError(getLastResult()); }
+
+  // Setters
+  inline void setBusStop() { busStatus_.busStop = true; }
+  inline void setBusRpte() { busStatus_.busStop = false; }
+  inline void setBusStopFlag(bool busStop) { busStatus_.busStop = busStop; }
+  inline void setBusClock(ClockSpeeds clockSpeed)
+  {
+    busStatus_.clock = clockSpeed;
+  }
+  inline void setDelaySend(uint32_t delay) { busStatus_.delaySend = delay; }
+  inline void setDelayReceive(uint32_t delay)
+  {
+    busStatus_.delayReceive = delay;
+  }
+  inline void setTimestampSend() { busStatus_.timestampSend = millis(); }
+  inline void setTimestampReceive() { busStatus_.timestampReceive = millis(); }
+
+  // Getters
+  inline bool getBusStop() { return busStatus_.busStop; }
+  inline ClockSpeeds getBusClock() { return busStatus_.clock; }
+  inline uint8_t getAddress() { return busStatus_.address; }
+  inline uint8_t getPinSDA() { return busStatus_.pinSDA; }
+  inline uint8_t getPinSCL() { return busStatus_.pinSCL; }
+
+protected:
+  ResultCodes registerAddress(uint8_t address);
+  // Wait for expiration of the send or receive delay since its timestamp
+  void waitSend();
+  void waitReceive();
+
+private:
+  enum Addressing : uint8_t
+  {
+    ADDRESS_MIN = 0x03, // Lowest usable 7 bit address
+    ADDRESS_MAX = 0x77, // Highest usable 7 bit address
+  };
+  struct Bus
+  {
+    ClockSpeeds clock;
+    uint32_t delaySend; // In milliseconds
+    uint32_t delayReceive; // In milliseconds
+    uint32_t timestampSend; // In milliseconds
+    uint32_t timestampReceive; // In milliseconds
+    uint8_t address;
+    uint8_t pinSDA;
+    uint8_t pinSCL;
+    bool busStop;
+    ResultCodes lastResult;
+  } busStatus_;
+};
+
+#endif
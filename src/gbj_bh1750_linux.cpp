@@ -0,0 +1,187 @@
+#if defined(GBJ_BH1750_TRANSPORT_LINUX)
+  #include "gbj_bh1750_linux.h"
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <linux/i2c-dev.h>
+  #include <linux/i2c.h>
+  #include <stdio.h>
+  #include <sys/ioctl.h>
+  #include <time.h>
+  #include <unistd.h>
+
+namespace
+{
+uint64_t monotonicMicros()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+}
+}
+
+uint32_t millis()
+{
+  return static_cast<uint32_t>(monotonicMicros() / 1000ULL);
+}
+
+uint32_t micros()
+{
+  return static_cast<uint32_t>(monotonicMicros());
+}
+
+void delay(uint32_t ms)
+{
+  delayMicroseconds(ms * 1000UL);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+  struct timespec ts;
+  ts.tv_sec = us / 1000000UL;
+  ts.tv_nsec = (us % 1000000UL) * 1000UL;
+  while (nanosleep(&ts, &ts) && errno == EINTR)
+  {
+  }
+}
+
+gbj_bh1750_linux::ResultCodes gbj_bh1750_linux::begin()
+{
+  char path[Params::PARAM_PATH];
+  release();
+  snprintf(path, sizeof(path), "/dev/i2c-%u", busNumber_);
+  fd_ = open(path, O_RDWR);
+  if (fd_ < 0)
+  {
+    return setLastResult(ResultCodes::ERROR_PINS);
+  }
+  return setLastResult();
+}
+
+void gbj_bh1750_linux::release()
+{
+  if (fd_ >= 0)
+  {
+    close(fd_);
+    fd_ = -1;
+  }
+  pendingCount_ = 0;
+}
+
+gbj_bh1750_linux::ResultCodes gbj_bh1750_linux::busSend(uint16_t data)
+{
+  // Full queue is issued on its own rather than losing the commands
+  if (pendingCount_ >= Params::PARAM_PENDING)
+  {
+    waitSend();
+    transfer();
+    setTimestampSend();
+    if (isError())
+    {
+      return getLastResult();
+    }
+  }
+  Pending &msg = pending_[pendingCount_++];
+  msg.len = 0;
+  if (data > 0xFF)
+  {
+    msg.data[msg.len++] = data >> 8;
+  }
+  msg.data[msg.len++] = data & 0xFF;
+  if (!getBusStop())
+  {
+    return setLastResult();
+  }
+  waitSend();
+  transfer();
+  setTimestampSend();
+  return getLastResult();
+}
+
+gbj_bh1750_linux::ResultCodes gbj_bh1750_linux::busReceive(uint8_t *dataArray,
+                                                           uint8_t bytes)
+{
+  // Commands queued at repeated start must not wait for the receive delay
+  if (pendingCount_ && isError(transfer()))
+  {
+    return getLastResult();
+  }
+  waitReceive();
+  return transfer(dataArray, bytes);
+}
+
+gbj_bh1750_linux::ResultCodes gbj_bh1750_linux::busProbe(uint8_t address)
+{
+  // Zero length write is the quick command of the bus
+  struct i2c_msg msg;
+  struct i2c_rdwr_ioctl_data xfer;
+  if (fd_ < 0)
+  {
+    return setLastResult(ResultCodes::ERROR_PINS);
+  }
+  msg.addr = address;
+  msg.flags = 0;
+  msg.len = 0;
+  msg.buf = NULL;
+  xfer.msgs = &msg;
+  xfer.nmsgs = 1;
+  if (ioctl(fd_, I2C_RDWR, &xfer) < 0)
+  {
+    return setLastResult(errno == ENXIO || errno == EREMOTEIO
+                           ? ResultCodes::ERROR_NACK_ADDR
+                           : ResultCodes::ERROR_NACK_OTHER);
+  }
+  return setLastResult();
+}
+
+gbj_bh1750_linux::ResultCodes gbj_bh1750_linux::transfer(uint8_t *dataArray,
+                                                         uint8_t bytes)
+{
+  struct i2c_msg msgs[Params::PARAM_PENDING + 1];
+  struct i2c_rdwr_ioctl_data xfer;
+  uint8_t count = 0;
+  if (fd_ < 0)
+  {
+    pendingCount_ = 0;
+    return setLastResult(ResultCodes::ERROR_PINS);
+  }
+  for (uint8_t i = 0; i < pendingCount_; i++)
+  {
+    msgs[count].addr = getAddress();
+    msgs[count].flags = 0;
+    msgs[count].len = pending_[i].len;
+    msgs[count].buf = pending_[i].data;
+    count++;
+  }
+  pendingCount_ = 0;
+  if (bytes)
+  {
+    msgs[count].addr = getAddress();
+    msgs[count].flags = I2C_M_RD;
+    msgs[count].len = bytes;
+    msgs[count].buf = dataArray;
+    count++;
+  }
+  if (!count)
+  {
+    return setLastResult();
+  }
+  xfer.msgs = msgs;
+  xfer.nmsgs = count;
+  if (ioctl(fd_, I2C_RDWR, &xfer) < 0)
+  {
+    switch (errno)
+    {
+      case ENXIO:
+        return setLastResult(ResultCodes::ERROR_NACK_ADDR);
+      case EREMOTEIO:
+        return setLastResult(ResultCodes::ERROR_NACK_DATA);
+      case ETIMEDOUT:
+        return setLastResult(ResultCodes::ERROR_TIMEOUT);
+      default:
+        return setLastResult(ResultCodes::ERROR_NACK_OTHER);
+    }
+  }
+  return setLastResult();
+}
+
+#endif
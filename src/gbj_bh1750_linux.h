@@ -0,0 +1,98 @@
+/*
+  NAME:
+  gbj_bh1750_linux
+
+  DESCRIPTION:
+  Bus transport for Linux gateways accessing the sensor through the i2c-dev
+  interface of the kernel, i.e., device file /dev/i2c-N.
+  - All transfers are made by the ioctl I2C_RDWR, so that each transaction
+    is a single system call.
+  - Commands sent while the bus stop flag is cleared are queued and flushed
+    together with the next command sent with the bus stop flag set as one
+    combined transfer joined by repeated starts, which is the way the
+    two-wire bus keeps the bus between transmissions.
+  - Commands queued before a reading are flushed in a transfer of their own
+    right before it, so that they do not wait for the receive delay.
+  - The queue holds the longest sequence of the library, i.e., power on,
+    reset, both parts of the measurement time register, and measurement
+    mode. A longer sequence is flushed in more transfers.
+  - The bus clock is determined by the kernel adapter driver, so that the
+    clock speed is just stored for reference.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_LINUX_H
+#define GBJ_BH1750_LINUX_H
+
+#include "gbj_bh1750_host.h"
+
+class gbj_bh1750_linux : public gbj_bh1750_host
+{
+public:
+  gbj_bh1750_linux(ClockSpeeds clockSpeed = ClockSpeeds::CLOCK_100KHZ,
+                   uint8_t pinSDA = 4,
+                   uint8_t pinSCL = 5)
+    : gbj_bh1750_host(clockSpeed, pinSDA, pinSCL)
+  {
+    fd_ = -1;
+    busNumber_ = 1;
+    pendingCount_ = 0;
+  }
+  ~gbj_bh1750_linux() { release(); }
+
+  /*
+    Open the bus device file.
+
+    DESCRIPTION:
+    The method opens the device file /dev/i2c-N for the bus number set before.
+    If the bus is already open, it is reopened.
+
+    PARAMETERS: none
+
+    RETURN: Result code
+  */
+  ResultCodes begin();
+
+  /*
+    Close the bus device file.
+
+    PARAMETERS: none
+
+    RETURN: none
+  */
+  void release();
+
+  // Number N of the bus device file /dev/i2c-N
+  inline void setBusNumber(uint8_t busNumber) { busNumber_ = busNumber; }
+  inline uint8_t getBusNumber() { return busNumber_; }
+
+protected:
+  ResultCodes busSend(uint16_t data);
+  ResultCodes busReceive(uint8_t *dataArray, uint8_t bytes);
+  ResultCodes busProbe(uint8_t address);
+
+private:
+  enum Params : uint8_t
+  {
+    PARAM_PENDING = 5, // Maximal number of commands in one transfer
+    PARAM_PATH = 16, // Buffer length for the device file path
+  };
+  struct Pending
+  {
+    uint8_t data[2];
+    uint8_t len;
+  } pending_[Params::PARAM_PENDING];
+  uint8_t pendingCount_;
+  uint8_t busNumber_;
+  int fd_;
+  // Issue queued commands and optional reading as one combined transfer
+  ResultCodes transfer(uint8_t *dataArray = NULL, uint8_t bytes = 0);
+};
+
+#endif
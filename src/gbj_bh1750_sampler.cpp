@@ -0,0 +1,74 @@
+#include "gbj_bh1750_sampler.h"
+
+void gbj_bh1750_sampler::begin(gbj_bh1750 &sensor,
+                               uint32_t periodMin,
+                               uint32_t periodMax)
+{
+  sensor_ = &sensor;
+  periodMin_ = periodMin;
+  periodMax_ = max(periodMin, periodMax);
+  period_ = periodMin_;
+  startAt_ = millis();
+  reference_ = samples_ = 0;
+  started_ = false;
+}
+
+bool gbj_bh1750_sampler::run()
+{
+  uint32_t now = millis();
+  if (!started_)
+  {
+    if (static_cast<int32_t>(now - startAt_) < 0)
+    {
+      return false;
+    }
+    if (sensor_->isError(sensor_->measureLightStart()))
+    {
+      startAt_ = now + periodMin_;
+      return false;
+    }
+    readAt_ = now + sensor_->getMeasurementTime();
+    started_ = true;
+    return false;
+  }
+  if (static_cast<int32_t>(now - readAt_) < 0)
+  {
+    return false;
+  }
+  started_ = false;
+  if (sensor_->isError(sensor_->measureLightFinish()))
+  {
+    startAt_ = now + periodMin_;
+    return false;
+  }
+  adapt(sensor_->getLightMilliLuxTyp());
+  // Keep the schedule, unless it has been missed
+  startAt_ += period_;
+  if (static_cast<int32_t>(now - startAt_) > 0)
+  {
+    startAt_ = now;
+  }
+  return true;
+}
+
+uint32_t gbj_bh1750_sampler::getBand()
+{
+  uint32_t band = sensor_->getLightResolutionMilli() * bandSteps_;
+  return max(band, reference_ / 100 * bandPerc_);
+}
+
+void gbj_bh1750_sampler::adapt(uint32_t milliLux)
+{
+  uint32_t change =
+    milliLux > reference_ ? milliLux - reference_ : reference_ - milliLux;
+  if (!samples_++ || change > getBand())
+  {
+    // Light changes, so that it should be followed closely
+    reference_ = milliLux;
+    period_ = periodMin_;
+  }
+  else
+  {
+    period_ = min(2 * period_, periodMax_);
+  }
+}
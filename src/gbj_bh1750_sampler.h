@@ -0,0 +1,141 @@
+/*
+  NAME:
+  gbj_bh1750_sampler
+
+  DESCRIPTION:
+  Adaptive sampler of a sensor adjusting its sampling period by the rate of
+  change of light intensity.
+  - While samples stay within the noise band around the reference sample,
+    the period is doubled up to the maximal period, so that stable light is
+    sampled rarely, which saves bus traffic and power.
+  - A sample out of the band becomes the new reference and the period drops
+    to the minimal one immediately, so that transitions are well resolved.
+  - The noise band is derived in milli-lux from the current resolution of
+    the sensor and a relative tolerance, so that it follows changes of mode
+    and measurement time register.
+  - The sampler does not block. A measurement is started at its planned
+    time and read after measurement time of the sensor.
+  - Only integer arithmetic is used.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_SAMPLER_H
+#define GBJ_BH1750_SAMPLER_H
+
+#include "gbj_bh1750.h"
+
+class gbj_bh1750_sampler
+{
+public:
+  gbj_bh1750_sampler()
+  {
+    sensor_ = NULL;
+    bandSteps_ = Params::PARAM_BAND_STEPS;
+    bandPerc_ = Params::PARAM_BAND_PERC;
+  }
+
+  /*
+    Start adaptive sampling of a sensor.
+
+    DESCRIPTION:
+    The first measurement is started at the next run of the sampler.
+
+    PARAMETERS:
+    sensor - Initialized sensor object.
+      - Data type: gbj_bh1750
+      - Default value: none
+      - Limited range: none
+
+    periodMin - Sampling period at changing light in milliseconds.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range: longer than measurement time of the sensor
+
+    periodMax - Sampling period at stable light in milliseconds.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range: periodMin ~ 2^31 - 1
+
+    RETURN: none
+  */
+  void begin(gbj_bh1750 &sensor, uint32_t periodMin, uint32_t periodMax);
+
+  /*
+    Start or finish a measurement when it is due.
+
+    DESCRIPTION:
+    The method should be called in the loop as often as possible. After
+    a successful reading the light getters of the sensor provide the new
+    sample.
+    - At failed measurement the period is kept and the measurement is
+      repeated after the minimal period.
+
+    PARAMETERS: none
+
+    RETURN: Flag about a new successful sample
+  */
+  bool run();
+
+  /*
+    Set the noise band of samples considered unchanged.
+
+    DESCRIPTION:
+    The half-width of the band is the larger of the resolution steps and the
+    percentage of the reference sample.
+
+    PARAMETERS:
+    steps - Number of smallest distinguishable changes of light.
+      - Data type: non-negative integer
+      - Default value: 2
+      - Limited range: 0 ~ 255
+
+    percent - Relative tolerance to the reference sample.
+      - Data type: non-negative integer
+      - Default value: 2
+      - Limited range: 0 ~ 100
+
+    RETURN: none
+  */
+  inline void setBand(uint8_t steps, uint8_t percent)
+  {
+    bandSteps_ = steps;
+    bandPerc_ = percent;
+  }
+
+  // Current sampling period in milliseconds
+  inline uint32_t getPeriod() { return period_; }
+  // Number of successful samples since begin
+  inline uint32_t getSamples() { return samples_; }
+  // Reference sample in milli-lux the band is centered on
+  inline uint32_t getReference() { return reference_; }
+  // Current half-width of the noise band in milli-lux
+  uint32_t getBand();
+
+private:
+  enum Params : uint8_t
+  {
+    PARAM_BAND_STEPS = 2, // Default resolution steps of the band
+    PARAM_BAND_PERC = 2, // Default relative tolerance of the band
+  };
+  gbj_bh1750 *sensor_;
+  uint32_t periodMin_;
+  uint32_t periodMax_;
+  uint32_t period_;
+  uint32_t startAt_; // Planned start of next measurement
+  uint32_t readAt_; // Planned reading of started measurement
+  uint32_t reference_;
+  uint32_t samples_;
+  uint8_t bandSteps_;
+  uint8_t bandPerc_;
+  bool started_;
+  // Adjust the period by a new sample in milli-lux
+  void adapt(uint32_t milliLux);
+};
+
+#endif
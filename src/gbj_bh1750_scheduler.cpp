@@ -0,0 +1,135 @@
+#include "gbj_bh1750_scheduler.h"
+
+bool gbj_bh1750_scheduler::add(gbj_bh1750 &sensor,
+                               uint32_t period,
+                               uint32_t deadline)
+{
+  if (count_ >= capacity_)
+  {
+    return false;
+  }
+  Task &task = tasks_[count_++];
+  task.sensor = &sensor;
+  task.period = period;
+  task.deadline = deadline;
+  task.started = false;
+  return true;
+}
+
+void gbj_bh1750_scheduler::begin()
+{
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < count_; i++)
+  {
+    Task &task = tasks_[i];
+    task.samples = task.missed = task.jitterSum = 0;
+    task.jitterMax = 0;
+    task.started = false;
+    // Tasks not planned yet must not block planning of others
+    task.readAt = now - 2 * Params::PARAM_SLOT;
+  }
+  for (uint8_t i = 0; i < count_; i++)
+  {
+    Task &task = tasks_[i];
+    task.readAt = planSlot(i, now + task.sensor->getMeasurementTime());
+  }
+}
+
+uint8_t gbj_bh1750_scheduler::run()
+{
+  uint8_t readings = 0;
+  for (uint8_t i = 0; i < count_; i++)
+  {
+    Task &task = tasks_[i];
+    uint32_t now = millis();
+    if (!task.started)
+    {
+      // Skip periods missed entirely
+      while (static_cast<int32_t>(now - task.readAt) >
+             static_cast<int32_t>(task.period))
+      {
+        task.readAt += task.period;
+        task.missed++;
+      }
+      uint32_t startAt = task.readAt - task.sensor->getMeasurementTime();
+      if (static_cast<int32_t>(now - startAt) < 0)
+      {
+        continue;
+      }
+      task.sensor->measureLightStart();
+      task.started = true;
+    }
+    if (static_cast<int32_t>(millis() - task.readAt) >= 0)
+    {
+      read(i);
+      readings++;
+    }
+  }
+  return readings;
+}
+
+uint32_t gbj_bh1750_scheduler::getPeriod(uint8_t task)
+{
+  Task &t = tasks_[task];
+  return t.samples > 1 ? (t.readLast - t.readFirst) / (t.samples - 1) : 0;
+}
+
+uint16_t gbj_bh1750_scheduler::getJitterMean(uint8_t task)
+{
+  Task &t = tasks_[task];
+  return t.samples > 1 ? t.jitterSum / (t.samples - 1) : 0;
+}
+
+uint32_t gbj_bh1750_scheduler::planSlot(uint8_t task, uint32_t readAt)
+{
+  bool collision = true;
+  // Each pass either settles or moves the reading behind another task
+  for (uint8_t pass = 0; collision && pass < count_; pass++)
+  {
+    collision = false;
+    for (uint8_t i = 0; i < count_; i++)
+    {
+      int32_t distance = readAt - tasks_[i].readAt;
+      if (i != task && distance > -Params::PARAM_SLOT &&
+          distance < Params::PARAM_SLOT)
+      {
+        readAt = tasks_[i].readAt + Params::PARAM_SLOT;
+        collision = true;
+      }
+    }
+  }
+  return readAt;
+}
+
+void gbj_bh1750_scheduler::read(uint8_t task)
+{
+  Task &t = tasks_[task];
+  t.started = false;
+  t.sensor->measureLightFinish();
+  uint32_t timestamp = millis();
+  if (t.sensor->isError() || timestamp - t.readAt > t.deadline)
+  {
+    t.missed++;
+  }
+  if (t.samples)
+  {
+    uint32_t period = timestamp - t.readLast;
+    uint32_t jitter = period > t.period ? period - t.period : t.period - period;
+    t.jitterSum += jitter;
+    // Clamped to the type of the maximum, since cores with std::max do not
+    // accept mixed types
+    uint16_t jitterClamped = min(jitter, static_cast<uint32_t>(0xFFFF));
+    t.jitterMax = max(t.jitterMax, jitterClamped);
+  }
+  else
+  {
+    t.readFirst = timestamp;
+  }
+  t.readLast = timestamp;
+  t.samples++;
+  t.readAt = planSlot(task, t.readAt + t.period);
+  if (handler_)
+  {
+    handler_(task, *t.sensor, timestamp, context_);
+  }
+}
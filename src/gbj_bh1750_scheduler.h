@@ -0,0 +1,151 @@
+/*
+  NAME:
+  gbj_bh1750_scheduler
+
+  DESCRIPTION:
+  Deadline-aware periodic scheduler of measurements by multiple sensors.
+  - Each sensor is sampled at its own period. The measurement is started
+    measurement time of the sensor ahead of the planned reading, so that the
+    reading itself lands on schedule and the period does not drift by
+    conversion time.
+  - Readings of sensors are planned at least a bus slot apart, so that they
+    do not collide on the shared bus.
+  - The scheduler registers achieved period, jitter of it, and readings
+    missing their deadline for each sensor.
+  - Tasks are stored in an array provided by a caller, so that the scheduler
+    does not allocate any memory.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_SCHEDULER_H
+#define GBJ_BH1750_SCHEDULER_H
+
+#include "gbj_bh1750.h"
+
+class gbj_bh1750_scheduler
+{
+public:
+  // Called after each reading with its timestamp in milliseconds
+  typedef void (*Handler)(uint8_t task,
+                          gbj_bh1750 &sensor,
+                          uint32_t timestamp,
+                          void *context);
+  struct Task
+  {
+    gbj_bh1750 *sensor;
+    uint32_t period; // Sampling period in milliseconds
+    uint32_t deadline; // Allowed lateness of reading in milliseconds
+    uint32_t readAt; // Planned time of next reading
+    uint32_t readFirst; // Time of the first reading
+    uint32_t readLast; // Time of the recent reading
+    uint32_t samples; // Readings
+    uint32_t missed; // Readings after deadline or skipped
+    uint32_t jitterSum; // Sum of absolute period deviations
+    uint16_t jitterMax; // Maximal absolute period deviation
+    bool started; // Measurement started and waiting for reading
+  };
+
+  gbj_bh1750_scheduler(Task *tasks, uint8_t capacity)
+  {
+    tasks_ = tasks;
+    capacity_ = capacity;
+    count_ = 0;
+    handler_ = NULL;
+    context_ = NULL;
+  }
+
+  /*
+    Add sensor to scheduling.
+
+    PARAMETERS:
+    sensor - Initialized sensor object.
+      - Data type: gbj_bh1750
+      - Default value: none
+      - Limited range: none
+
+    period - Sampling period in milliseconds.
+      - Data type: non-negative integer
+      - Default value: none
+      - Limited range: longer than measurement time of the sensor
+
+    deadline - Allowed lateness of a reading in milliseconds.
+      - Data type: non-negative integer
+      - Default value: 5
+      - Limited range: 0 ~ period
+
+    RETURN: Flag about success, false if there is no room for the task
+  */
+  bool add(gbj_bh1750 &sensor,
+           uint32_t period,
+           uint32_t deadline = Params::PARAM_DEADLINE);
+
+  /*
+    Plan first readings of all tasks.
+
+    DESCRIPTION:
+    The first readings are planned after measurement time of particular
+    sensor from now and at least a bus slot apart from each other.
+    Statistics are cleared.
+
+    PARAMETERS: none
+
+    RETURN: none
+  */
+  void begin();
+
+  /*
+    Process due measurement starts and readings.
+
+    DESCRIPTION:
+    The method should be called in the loop as often as possible. If a task
+    got late more than its period, the skipped readings are counted as
+    missed and the task continues on its original time grid.
+
+    PARAMETERS: none
+
+    RETURN: Number of readings made
+  */
+  uint8_t run();
+
+  inline void setHandler(Handler handler, void *context = NULL)
+  {
+    handler_ = handler;
+    context_ = context;
+  }
+
+  // Getters of task statistics
+  inline uint8_t getTasks() { return count_; }
+  inline uint32_t getSamples(uint8_t task) { return tasks_[task].samples; }
+  inline uint32_t getMissed(uint8_t task) { return tasks_[task].missed; }
+  // Average achieved period in milliseconds
+  uint32_t getPeriod(uint8_t task);
+  // Maximal and average absolute deviation of period in milliseconds
+  inline uint16_t getJitterMax(uint8_t task)
+  {
+    return tasks_[task].jitterMax;
+  }
+  uint16_t getJitterMean(uint8_t task);
+
+private:
+  enum Params : uint8_t
+  {
+    PARAM_SLOT = 2, // Minimal distance of readings in milliseconds
+    PARAM_DEADLINE = 5, // Default deadline in milliseconds
+  };
+  Task *tasks_;
+  Handler handler_;
+  void *context_;
+  uint8_t capacity_;
+  uint8_t count_;
+  // Shift the reading time away from readings of other tasks
+  uint32_t planSlot(uint8_t task, uint32_t readAt);
+  void read(uint8_t task);
+};
+
+#endif
@@ -0,0 +1,256 @@
+#if defined(GBJ_BH1750_TRANSPORT_SIM)
+  #include "gbj_bh1750_sim.h"
+
+namespace
+{
+uint64_t simTime; // Virtual time in microseconds
+}
+
+uint32_t millis()
+{
+  return static_cast<uint32_t>(simTime / 1000ULL);
+}
+
+uint32_t micros()
+{
+  return static_cast<uint32_t>(simTime);
+}
+
+void delay(uint32_t ms)
+{
+  simTime += 1000ULL * ms;
+}
+
+void delayMicroseconds(uint32_t us)
+{
+  simTime += us;
+}
+
+void gbj_bh1750_sim::advance(uint32_t us)
+{
+  simTime += us;
+}
+
+void gbj_bh1750_sim::simPowerCycle()
+{
+  sim_.powered = false;
+  sim_.mode = 0;
+  sim_.mtreg = SimParams::SIM_MTREG;
+  sim_.data = 0;
+  sim_.start = micros();
+}
+
+gbj_bh1750_sim::ResultCodes gbj_bh1750_sim::busSend(uint16_t data)
+{
+  uint8_t bytes = data > 0xFF ? 2 : 1;
+  waitSend();
+  simBusTime(bytes);
+  setTimestampSend();
+  if (getAddress() != sim_.address)
+  {
+    return setLastResult(ResultCodes::ERROR_NACK_ADDR);
+  }
+  if (simClockFault())
+  {
+    return setLastResult(ResultCodes::ERROR_NACK_OTHER);
+  }
+  // Faulty transfers do not reach the sensor
+  if (simFault(sim_.faultTimeout))
+  {
+    advance(1000UL * SimParams::SIM_TIMEOUT);
+    return setLastResult(ResultCodes::ERROR_TIMEOUT);
+  }
+  if (simFault(sim_.faultNack))
+  {
+    return setLastResult(ResultCodes::ERROR_NACK_DATA);
+  }
+  simUpdate();
+  uint8_t cmd = data & 0xFF;
+  switch (cmd & 0xE0)
+  {
+    case 0x40: // Measurement time register high bits
+      sim_.mtreg = (sim_.mtreg & 0x1F) | ((cmd & 0x07) << 5);
+      return setLastResult();
+    case 0x60: // Measurement time register low bits
+      sim_.mtreg = (sim_.mtreg & 0xE0) | (cmd & 0x1F);
+      return setLastResult();
+    default:
+      break;
+  }
+  switch (cmd)
+  {
+    case 0x00: // Power down
+      sim_.powered = false;
+      sim_.mode = 0;
+      break;
+    case 0x01: // Power on
+      sim_.powered = true;
+      break;
+    case 0x07: // Reset is not acceptable in power down
+      if (!sim_.powered)
+      {
+        return setLastResult(ResultCodes::ERROR_NACK_DATA);
+      }
+      // Cleared register waits for the next finished conversion
+      sim_.data = 0;
+      sim_.start = micros();
+      break;
+    case 0x10:
+    case 0x11:
+    case 0x13:
+    case 0x20:
+    case 0x21:
+    case 0x23:
+      sim_.powered = true;
+      sim_.mode = cmd;
+      sim_.start = micros();
+      break;
+    default:
+      return setLastResult(ResultCodes::ERROR_NACK_DATA);
+  }
+  return setLastResult();
+}
+
+gbj_bh1750_sim::ResultCodes gbj_bh1750_sim::busReceive(uint8_t *dataArray,
+                                                       uint8_t bytes)
+{
+  waitReceive();
+  simBusTime(bytes);
+  if (getAddress() != sim_.address)
+  {
+    return setLastResult(ResultCodes::ERROR_NACK_ADDR);
+  }
+  if (simFault(sim_.faultTimeout))
+  {
+    advance(1000UL * SimParams::SIM_TIMEOUT);
+    return setLastResult(ResultCodes::ERROR_TIMEOUT);
+  }
+  if (simFault(sim_.faultNack))
+  {
+    return setLastResult(ResultCodes::ERROR_NACK_ADDR);
+  }
+  simUpdate();
+  for (uint8_t i = 0; i < bytes; i++)
+  {
+    dataArray[i] = i % 2 ? sim_.data & 0xFF : sim_.data >> 8;
+    // Bits sampled too early vary from transfer to transfer
+    if (simClockFault())
+    {
+      dataArray[i] ^= micros() & 0xFF;
+    }
+  }
+  // Single flipped bit is not detectable by the master
+  if (bytes && simFault(sim_.faultCorrupt))
+  {
+    uint32_t bit = simRandom();
+    dataArray[bit / 8 % bytes] ^= 1 << (bit % 8);
+    sim_.corruptions++;
+  }
+  return setLastResult();
+}
+
+gbj_bh1750_sim::ResultCodes gbj_bh1750_sim::busProbe(uint8_t address)
+{
+  simBusTime(0);
+  if (address != sim_.address)
+  {
+    return setLastResult(ResultCodes::ERROR_NACK_ADDR);
+  }
+  return setLastResult();
+}
+
+uint32_t gbj_bh1750_sim::simConversionTime()
+{
+  uint32_t timeTyp = (sim_.mode & 0x03) == 0x03 ? 16000UL : 120000UL;
+  return timeTyp * sim_.mtreg / SimParams::SIM_MTREG * sim_.timeScale / 100;
+}
+
+uint16_t gbj_bh1750_sim::simConvert(uint32_t windowStart, uint32_t windowLen)
+{
+  double lux = sim_.lux;
+  if (sim_.source)
+  {
+    lux = 0.0;
+    for (uint8_t i = 0; i < SimParams::SIM_SAMPLES; i++)
+    {
+      uint32_t t =
+        windowStart + windowLen * (2 * i + 1) / (2 * SimParams::SIM_SAMPLES);
+      lux += sim_.source(t, sim_.context);
+    }
+    lux /= static_cast<uint8_t>(SimParams::SIM_SAMPLES);
+  }
+  double count = lux * sim_.accuracy / 100.0 * sim_.mtreg /
+                 static_cast<uint8_t>(SimParams::SIM_MTREG);
+  if ((sim_.mode & 0x03) == 0x01)
+  {
+    count *= 2.0;
+  }
+  if (count < 0.0)
+  {
+    count = 0.0;
+  }
+  if (count > 65535.0)
+  {
+    count = 65535.0;
+  }
+  uint16_t data = static_cast<uint16_t>(count);
+  // Low resolution mode has 4 lx resolution
+  if ((sim_.mode & 0x03) == 0x03)
+  {
+    data &= ~0x03;
+  }
+  return data;
+}
+
+void gbj_bh1750_sim::simUpdate()
+{
+  if (!sim_.powered || !sim_.mode)
+  {
+    return;
+  }
+  uint32_t duration = simConversionTime();
+  uint32_t elapsed = micros() - sim_.start;
+  if (!duration || elapsed < duration)
+  {
+    return;
+  }
+  if (sim_.mode & 0x20)
+  {
+    // One time mode powers down after conversion
+    sim_.data = simConvert(sim_.start, duration);
+    sim_.powered = false;
+    sim_.mode = 0;
+  }
+  else
+  {
+    // Continuous mode keeps the result of the latest finished conversion
+    uint32_t cycles = elapsed / duration;
+    sim_.data = simConvert(sim_.start + (cycles - 1) * duration, duration);
+  }
+}
+
+void gbj_bh1750_sim::simBusTime(uint8_t bytes)
+{
+  // Address byte plus data bytes
+  uint32_t bits = (bytes + 1) * SimParams::SIM_FRAME + SimParams::SIM_OVERHEAD;
+  advance((bits * 1000000UL + getBusClock() - 1) / getBusClock());
+}
+
+uint32_t gbj_bh1750_sim::simRandom()
+{
+  // Linear congruential generator with the upper bits being the most random
+  sim_.seed = sim_.seed * 1103515245UL + 12345UL;
+  return sim_.seed >> 16;
+}
+
+bool gbj_bh1750_sim::simFault(uint8_t percent)
+{
+  if (!percent || simRandom() % 100 >= percent)
+  {
+    return false;
+  }
+  sim_.faults++;
+  return true;
+}
+
+#endif
@@ -0,0 +1,160 @@
+/*
+  NAME:
+  gbj_bh1750_sim
+
+  DESCRIPTION:
+  In-memory simulator of the sensor BH1750FVI acting as a bus transport for
+  host builds and testing of the library without any hardware.
+  - The simulator interprets the sensor instruction set, i.e., power down,
+    power on, reset, measurement modes, and measurement time register writes.
+  - Conversions run on the virtual time driven by the functions delay() and
+    delayMicroseconds(), so that a simulated run is deterministic and does
+    not sleep in real time.
+  - Each bus transfer advances the virtual time by its duration at current
+    bus clock speed.
+  - The data register integrates the simulated illuminance over the
+    conversion window, which is either constant or provided by a callback
+    as a function of time.
+  - Bus faults, i.e., NACKs, timeouts, and corrupted reads, can be injected
+    at random with configurable rates from a reproducible sequence.
+
+  LICENSE:
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the MIT License (MIT).
+
+  CREDENTIALS:
+  Author: Libor Gabaj
+  GitHub: https://github.com/mrkaleArduinoLib/gbj_bh1750.git
+ */
+#ifndef GBJ_BH1750_SIM_H
+#define GBJ_BH1750_SIM_H
+
+#include "gbj_bh1750_host.h"
+
+class gbj_bh1750_sim : public gbj_bh1750_host
+{
+public:
+  // Illuminance in lux at the time in microseconds
+  typedef double (*LightSource)(uint32_t timeUs, void *context);
+
+  gbj_bh1750_sim(ClockSpeeds clockSpeed = ClockSpeeds::CLOCK_100KHZ,
+                 uint8_t pinSDA = 4,
+                 uint8_t pinSCL = 5)
+    : gbj_bh1750_host(clockSpeed, pinSDA, pinSCL)
+  {
+    sim_.address = SimParams::SIM_ADDRESS;
+    sim_.accuracy = SimParams::SIM_ACCURACY;
+    sim_.timeScale = SimParams::SIM_TIMESCALE;
+    sim_.clockMax = 0;
+    setSimFaults(0, 0, 0);
+    sim_.lux = 0.0;
+    sim_.source = NULL;
+    sim_.context = NULL;
+    simPowerCycle();
+  }
+
+  inline ResultCodes begin() { return setLastResult(); }
+  inline void release() {}
+
+  // Simulated sensor setup
+  inline void setSimAddress(uint8_t address) { sim_.address = address; }
+  inline void setSimLight(double lux)
+  {
+    sim_.lux = lux;
+    sim_.source = NULL;
+  }
+  inline void setSimLightSource(LightSource source, void *context = NULL)
+  {
+    sim_.source = source;
+    sim_.context = context;
+  }
+  // Real conversion time in percentage of the datasheet typical one
+  inline void setSimTimeScale(uint8_t percent) { sim_.timeScale = percent; }
+  // Real sensor accuracy in count/lux with 2 fraction digits
+  inline void setSimAccuracy(uint8_t accuracy) { sim_.accuracy = accuracy; }
+  // Highest bus clock without transfer errors, zero for any clock
+  inline void setSimClockMax(uint32_t clock) { sim_.clockMax = clock; }
+  // Rates of injected faults in percent of transfers and their random seed
+  inline void setSimFaults(uint8_t nackPerc,
+                           uint8_t timeoutPerc,
+                           uint8_t corruptPerc,
+                           uint32_t seed = 1)
+  {
+    sim_.faultNack = nackPerc;
+    sim_.faultTimeout = timeoutPerc;
+    sim_.faultCorrupt = corruptPerc;
+    sim_.seed = seed;
+    sim_.faults = sim_.corruptions = 0;
+  }
+  // Turn the simulated sensor supply off and on
+  void simPowerCycle();
+  inline uint8_t getSimAddress() { return sim_.address; }
+  inline uint8_t getSimMtreg() { return sim_.mtreg; }
+  inline uint8_t getSimMode() { return sim_.mode; }
+  inline bool getSimPowered() { return sim_.powered; }
+  // Number of injected faults since their setting
+  inline uint32_t getSimFaults() { return sim_.faults; }
+  // Number of injected corrupted reads since setting of faults
+  inline uint32_t getSimCorruptions() { return sim_.corruptions; }
+  inline uint16_t getSimData()
+  {
+    simUpdate();
+    return sim_.data;
+  }
+
+  // Advance the virtual time
+  static void advance(uint32_t us);
+
+protected:
+  ResultCodes busSend(uint16_t data);
+  ResultCodes busReceive(uint8_t *dataArray, uint8_t bytes);
+  ResultCodes busProbe(uint8_t address);
+
+private:
+  enum SimParams : uint8_t
+  {
+    SIM_ADDRESS = 0x23, // Default address with ADDR pin grounded
+    SIM_ACCURACY = 120, // Typical accuracy 1.2 count/lux
+    SIM_TIMESCALE = 100, // Conversion time as in datasheet
+    SIM_MTREG = 69, // Default value of measurement time register
+    SIM_SAMPLES = 8, // Light source samples per conversion window
+    SIM_FRAME = 9, // Bits per transferred byte including acknowledge
+    SIM_OVERHEAD = 2, // Bits of start and stop conditions
+    SIM_TIMEOUT = 25, // Transfer timeout at held bus line in milliseconds
+  };
+  struct Device
+  {
+    double lux; // Constant illuminance without light source
+    LightSource source;
+    void *context;
+    uint32_t start; // Start of current conversion in microseconds
+    uint32_t clockMax; // Highest reliable bus clock
+    uint32_t seed; // State of the fault sequence generator
+    uint32_t faults; // Injected faults
+    uint32_t corruptions; // Injected corrupted reads
+    uint16_t data; // Data register
+    uint8_t address;
+    uint8_t accuracy;
+    uint8_t timeScale;
+    uint8_t mode; // Current measurement instruction, zero if none
+    uint8_t mtreg; // Measurement time register
+    uint8_t faultNack; // Rates of injected faults in percent
+    uint8_t faultTimeout;
+    uint8_t faultCorrupt;
+    bool powered;
+  } sim_;
+  uint32_t simConversionTime();
+  uint16_t simConvert(uint32_t windowStart, uint32_t windowLen);
+  void simUpdate();
+  void simBusTime(uint8_t bytes);
+  uint32_t simRandom();
+  // Decide on a fault at a rate in percent
+  bool simFault(uint8_t percent);
+  // Bus clock is above the reliable one
+  inline bool simClockFault()
+  {
+    return sim_.clockMax && getBusClock() > sim_.clockMax;
+  }
+};
+
+#endif